@@ -0,0 +1,196 @@
+#include "alloctrack.h"
+
+#include <assert.h>
+#include <atomic>
+#include <errno.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Plain data, so reaching it from malloc never allocates or runs a constructor
+static thread_local AllocCounts threadAllocCounts;
+// Where the failures were last added up to, so nested checks don't count an allocation twice
+static thread_local AllocCounts threadFailedUpTo;
+
+static std::atomic<int> allocCheckMode{ allocCheckOff };
+static std::atomic<uint64_t> numFailedAllocs{ 0 };
+static std::atomic<uint64_t> numFailedBytes{ 0 };
+static std::atomic<int> numLoggedFailures{ 0 };
+
+// Printed before going quiet, a loop that allocates does it every frame
+constexpr int loggedFailuresCap = 10;
+
+static void countAlloc(size_t size)
+{
+    ++threadAllocCounts.numAllocs;
+    threadAllocCounts.numBytes += size;
+}
+
+#if defined(__GLIBC__)
+
+// glibc's own, the ones below call through to them. free() isn't counted, so it's left alone. Every
+// allocating entry point of glibc is replaced, operator new (aligned or not) and strdup and the like
+// end up in one of them.
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" void* __libc_valloc(size_t size);
+extern "C" void* __libc_pvalloc(size_t size);
+
+extern "C" void* malloc(size_t size) noexcept
+{
+    countAlloc(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept
+{
+    countAlloc(count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) noexcept
+{
+    if (size > 0)
+    {
+        countAlloc(size);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void* reallocarray(void* ptr, size_t count, size_t size) noexcept
+{
+    if (size && count > SIZE_MAX / size)
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return realloc(ptr, count * size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size) noexcept
+{
+    countAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    countAlloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept
+{
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0 || alignment == 0)
+    {
+        return EINVAL;
+    }
+    countAlloc(size);
+    void* p = __libc_memalign(alignment, size);
+    if (!p)
+    {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+
+extern "C" void* valloc(size_t size) noexcept
+{
+    countAlloc(size);
+    return __libc_valloc(size);
+}
+
+extern "C" void* pvalloc(size_t size) noexcept
+{
+    countAlloc(size);
+    return __libc_pvalloc(size);
+}
+
+#else
+
+// Only C++ allocations through the plain operator new are seen here. malloc and its relatives, and the
+// aligned operator new of C++17 libraries, aren't counted.
+void* operator new(size_t size)
+{
+    countAlloc(size);
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+#endif
+
+AllocCounts getThreadAllocCounts()
+{
+    return threadAllocCounts;
+}
+
+void setAllocCheckMode(AllocCheckMode mode)
+{
+    allocCheckMode.store(mode);
+    numFailedAllocs.store(0);
+    numFailedBytes.store(0);
+    numLoggedFailures.store(0);
+}
+
+void endAllocCheck(const AllocCheck* check)
+{
+    AllocCheckMode mode = (AllocCheckMode)allocCheckMode.load(std::memory_order_relaxed);
+    if (mode == allocCheckOff)
+    {
+        return;
+    }
+
+    AllocCounts counts = threadAllocCounts;
+    uint64_t numAllocs = counts.numAllocs - check->start.numAllocs;
+    if (numAllocs == 0)
+    {
+        return;
+    }
+    uint64_t numBytes = counts.numBytes - check->start.numBytes;
+    if (threadFailedUpTo.numAllocs < counts.numAllocs)
+    {
+        bool isNested = threadFailedUpTo.numAllocs > check->start.numAllocs;
+        const AllocCounts& from = isNested ? threadFailedUpTo : check->start;
+        numFailedAllocs += counts.numAllocs - from.numAllocs;
+        numFailedBytes += counts.numBytes - from.numBytes;
+        threadFailedUpTo = counts;
+    }
+
+    int numLogged = numLoggedFailures++;
+    if (numLogged < loggedFailuresCap)
+    {
+        fprintf(stderr, "%llu allocations (%llu bytes) in %s%s\n", (unsigned long long)numAllocs,
+            (unsigned long long)numBytes, check->name, numLogged == loggedFailuresCap - 1 ? ", not printing any more" : "");
+    }
+    assert(mode != allocCheckAssert && "Allocated where it shouldn't");
+}
+
+AllocCounts getAllocCheckFailures()
+{
+    AllocCounts counts;
+    counts.numAllocs = numFailedAllocs.load();
+    counts.numBytes = numFailedBytes.load();
+    return counts;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+
+// Opt-in counting of heap allocations, to keep the frame loop from allocating. Targets built with
+// -DMY_PINBALL_ALLOC_TRACKING=ON count every allocation of each thread: with glibc every allocating
+// entry point (malloc, calloc, realloc, reallocarray, memalign, aligned_alloc, posix_memalign, valloc,
+// pvalloc) is interposed, which covers operator new too. Elsewhere only the plain operator new is replaced
+// and C allocations go uncounted. Checks around the parts of the loop that
+// shouldn't allocate (a simulation tick, the game side of a frame) then log or assert when they did.
+// In other builds the counts are always 0 and the checks compile to nothing.
+
+struct AllocCounts
+{
+    uint64_t numAllocs;
+    uint64_t numBytes;
+};
+
+// What a check does when its scope allocated
+enum AllocCheckMode
+{
+    // During startup, nothing
+    allocCheckOff,
+    // Counted and the first few printed
+    allocCheckLog,
+    // Counted, printed and asserted on
+    allocCheckAssert,
+};
+
+struct AllocCheck
+{
+    const char* name;
+    AllocCounts start;
+};
+
+#ifdef MY_PINBALL_ALLOC_TRACKING
+
+constexpr bool isAllocTracking = true;
+// Whether C allocations are counted too, see above
+#if defined(__GLIBC__)
+constexpr bool isAllocTrackingComplete = true;
+#else
+constexpr bool isAllocTrackingComplete = false;
+#endif
+
+// Of the calling thread since it started
+AllocCounts getThreadAllocCounts();
+
+// For every thread, starts out as allocCheckOff
+void setAllocCheckMode(AllocCheckMode mode);
+
+inline void beginAllocCheck(AllocCheck* check, const char* name)
+{
+    check->name = name;
+    check->start = getThreadAllocCounts();
+}
+
+void endAllocCheck(const AllocCheck* check);
+
+// Totals of the checks that allocated since the mode was last set
+AllocCounts getAllocCheckFailures();
+
+#else
+
+constexpr bool isAllocTracking = false;
+constexpr bool isAllocTrackingComplete = false;
+
+inline AllocCounts getThreadAllocCounts()
+{
+    return {};
+}
+
+inline void setAllocCheckMode(AllocCheckMode /*mode*/)
+{
+}
+
+inline void beginAllocCheck(AllocCheck* /*check*/, const char* /*name*/)
+{
+}
+
+inline void endAllocCheck(const AllocCheck* /*check*/)
+{
+}
+
+inline AllocCounts getAllocCheckFailures()
+{
+    return {};
+}
+
+#endif
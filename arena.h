@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Memory for things that are allocated together when a table is loaded and freed together when it goes.
+// The size is worked out from the table up front, so there's a single malloc and nothing to grow later.
+struct Arena
+{
+    unsigned char* base;
+    size_t size;
+    size_t used;
+};
+
+inline void initArena(Arena* arena, size_t size)
+{
+    arena->base = (unsigned char*)malloc(size ? size : 1);
+    arena->size = size;
+    arena->used = 0;
+}
+
+inline void freeArena(Arena* arena)
+{
+    free(arena->base);
+    *arena = {};
+}
+
+// Sizes passed to initArena() have to leave room for this much padding per allocation
+constexpr size_t arenaAlignment = 16;
+
+inline void* pushSize(Arena* arena, size_t size)
+{
+    size_t start = (arena->used + arenaAlignment - 1) & ~(arenaAlignment - 1);
+    if (start + size > arena->size)
+    {
+        // The size was worked out wrong, running on would write past the block
+        fprintf(stderr, "Arena of %zu bytes is out of memory\n", arena->size);
+        abort();
+    }
+    arena->used = start + size;
+    return arena->base + start;
+}
+
+// Bytes an arena needs for an array of count elements
+#define ARENA_ARRAY_SIZE(type, count) ((size_t)(count) * sizeof(type) + arenaAlignment)
+
+#define PUSH_ARRAY(arena, type, count) ((type*)pushSize(arena, (size_t)(count) * sizeof(type)))
@@ -0,0 +1,39 @@
+#include "autoplay.h"
+
+GameInput getAutoplayInput(const Game* game, int frameIndex)
+{
+    const Table* table = game->table;
+    const Ball& ball = game->ball;
+
+    GameInput input = {};
+
+    if (game->isGameOver)
+    {
+        // Restart by tapping a button
+        input.isLeftButtonDown = (frameIndex % 2) == 0;
+        return input;
+    }
+
+    // Pull the plunger all the way down, then release it
+    bool isBallNearPlunger = table->plungerLeftX < ball.p.x && ball.p.x < table->plungerRightX;
+    if (isBallNearPlunger && game->plungerT < 1.0f)
+    {
+        input.isRightButtonDown = true;
+        return input;
+    }
+
+    // Flip when the ball is coming down close to a flipper
+    const Flipper* left = &game->flippers[0];
+    const Flipper* right = &game->flippers[1];
+    constexpr float reach = Flipper::width + ballRadius;
+    if (ball.v.y < 0.0f && getDistance(ball.p, left->position) < reach)
+    {
+        input.isLeftButtonDown = true;
+    }
+    if (ball.v.y < 0.0f && getDistance(ball.p, right->position) < reach)
+    {
+        input.isRightButtonDown = true;
+    }
+
+    return input;
+}
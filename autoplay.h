@@ -0,0 +1,6 @@
+#pragma once
+
+#include "game.h"
+
+// Deterministic player so headless runs show some gameplay
+GameInput getAutoplayInput(const Game* game, int frameIndex);
@@ -0,0 +1,69 @@
+// Bakes a text table (see tablefile.h) into the binary form the game loads with a single read, or
+// writes out the built-in table or a generated one (see tablegen.h) as text.
+
+#include "tablefile.h"
+#include "tablegen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: my_pinball_bake IN.table OUT.ptb   bake a text table\n"
+        "       my_pinball_bake --export OUT.table  write the built-in table as text\n"
+        "       my_pinball_bake --generate N OUT.table\n"
+        "                                           write the built-in table with N generated primitives\n");
+}
+
+int main(int argc, char** argv)
+{
+    Table table;
+    if (argc == 4 && strcmp(argv[1], "--generate") == 0)
+    {
+        int numPrimitives = atoi(argv[2]);
+        if (numPrimitives < 0)
+        {
+            printUsage();
+            return 1;
+        }
+        if (!generateTable(&table, numPrimitives, 1))
+        {
+            return 1;
+        }
+        bool isOk = writeTableText(&table, argv[3]);
+        freeTable(&table);
+        return isOk ? 0 : 1;
+    }
+
+    if (argc != 3)
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (strcmp(argv[1], "--export") == 0)
+    {
+        buildTable(&table);
+        bool isOk = writeTableText(&table, argv[2]);
+        freeTable(&table);
+        return isOk ? 0 : 1;
+    }
+
+    if (!loadTable(&table, argv[1]))
+    {
+        return 1;
+    }
+    if (!writeBakedTable(&table, argv[2]))
+    {
+        freeTable(&table);
+        return 1;
+    }
+    printf("Baked %d walls, %d arcs, %d pop bumpers and %d buttons into %s (%zu bytes)\n",
+        table.numBasicWalls + table.numMirroredWalls + table.numSlingshotWalls + table.numOneWayWalls,
+        table.numArcs + table.numMirroredArcs, table.numPopBumpers, table.numButtons, argv[2],
+        getBakedTableSize(&table));
+    freeTable(&table);
+    return 0;
+}
@@ -0,0 +1,403 @@
+// Microbenchmarks of the geometry and collision functions the simulation and the drawing spend their
+// time in. Every benchmark runs over the same fixed set of random inputs, so numbers from two builds
+// can be compared, and reports nanoseconds per call. --json writes the results for scripts.
+
+// Included rather than linked, the functions are static and get inlined the same way as in the game
+#include "game.cpp"
+
+#include <stdio.h>
+#include <time.h>
+
+#include <algorithm>
+
+// A power of two, inputs are picked with i & (benchInputsCount - 1)
+constexpr int benchInputsCount = 1024;
+constexpr int benchRepeatsCap = 64;
+
+struct BenchInputs
+{
+    Circle circles[benchInputsCount];
+    Arc arcs[benchInputsCount];
+    LineSegment segments[benchInputsCount];
+    Flipper flippers[benchInputsCount];
+    Ball balls[benchInputsCount];
+    Vec2 normals[benchInputsCount];
+    float penetrations[benchInputsCount];
+    float bouncinesses[benchInputsCount];
+    Vec2 linePoints[benchInputsCount];
+    Vec2 lineDirections[benchInputsCount];
+    Ray rays[benchInputsCount];
+};
+
+static BenchInputs inputs;
+static Game benchGame;
+
+// Results are added up into this so the calls can't be optimized away
+static volatile float benchSink;
+
+// xorshift32, not the game's, so that the inputs don't change when the game's random numbers do
+static uint32_t benchRandomState = 1;
+
+static float getBenchFloat(float min, float max)
+{
+    uint32_t x = benchRandomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    benchRandomState = x;
+    return min + (max - min) * (float)(x >> 8) / (float)((1 << 24) - 1);
+}
+
+static Vec2 getBenchDirection()
+{
+    float angle = getBenchFloat(0.0f, twoPi);
+    return { cosf(angle), sinf(angle) };
+}
+
+// Balls close enough to the primitives that about half of the tests find a collision
+static void initInputs()
+{
+    benchRandomState = 1;
+    for (int i = 0; i < benchInputsCount; ++i)
+    {
+        Arc* arc = &inputs.arcs[i];
+        arc->p = { getBenchFloat(-20.0f, 20.0f), getBenchFloat(5.0f, 65.0f) };
+        arc->r = getBenchFloat(1.0f, 10.0f);
+        arc->start = getBenchFloat(0.0f, twoPi - 0.01f);
+        arc->end = getBenchFloat(0.0f, twoPi - 0.01f);
+
+        Circle* circ = &inputs.circles[i];
+        circ->p = arc->p + getBenchDirection() * (arc->r + getBenchFloat(-2.0f * ballRadius, 2.0f * ballRadius));
+        circ->r = ballRadius;
+
+        Vec2 d = getBenchDirection() * getBenchFloat(1.0f, 10.0f);
+        inputs.segments[i] = { circ->p - d + perp(normalize(d)) * getBenchFloat(-2.0f, 2.0f), circ->p + d };
+
+        bool isLeft = (i & 1) == 0;
+        Flipper* flipper = &inputs.flippers[i];
+        *flipper = makeFlipper(Vec2{ isLeft ? -flipperX : flipperX, flipperY }, isLeft);
+        flipper->orientation = getBenchFloat(flipper->minAngle, flipper->maxAngle);
+        updateTransform(flipper);
+
+        inputs.balls[i] = { circ->p, getBenchDirection() * getBenchFloat(0.0f, 100.0f) };
+        inputs.normals[i] = getBenchDirection();
+        inputs.penetrations[i] = getBenchFloat(0.0f, 0.5f);
+        // A quarter are bumpers, which turn the normal by a random angle
+        inputs.bouncinesses[i] = (i & 3) == 0 ? 4.0f : 0.5f;
+
+        inputs.linePoints[i] = circ->p;
+        inputs.lineDirections[i] = getBenchDirection();
+
+        // From inside the circle of the arc, so they always hit it
+        inputs.rays[i] = { arc->p + getBenchDirection() * getBenchFloat(0.0f, arc->r * 0.9f), getBenchDirection() };
+    }
+    // Only the random state is used
+    benchGame = {};
+    benchGame.randomState = 1;
+}
+
+// Each runs the function numOps times and returns something to add to benchSink
+
+static float benchArcIntersection(int numOps)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < numOps; ++i)
+    {
+        int j = i & (benchInputsCount - 1);
+        Collision c = checkIntersection(inputs.circles[j], inputs.arcs[j]);
+        sum += c.penetration;
+    }
+    return sum;
+}
+
+static float benchSegmentIntersection(int numOps)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < numOps; ++i)
+    {
+        int j = i & (benchInputsCount - 1);
+        Collision c = checkIntersection(inputs.circles[j], inputs.segments[j]);
+        sum += c.penetration;
+    }
+    return sum;
+}
+
+static float benchFlipperIntersection(int numOps)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < numOps; ++i)
+    {
+        int j = i & (benchInputsCount - 1);
+        Circle circ = { inputs.flippers[j].position + inputs.normals[j] * 4.0f, ballRadius };
+        Collision c = checkIntersection(circ, inputs.flippers[j]);
+        sum += c.penetration;
+    }
+    return sum;
+}
+
+static float benchResolveCollision(int numOps)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < numOps; ++i)
+    {
+        int j = i & (benchInputsCount - 1);
+        Ball ball = inputs.balls[j];
+        Vec2 normal = inputs.normals[j];
+        resolveCollision(&benchGame, collisionWall, &ball, normal, inputs.penetrations[j], -fabsf(dot(ball.v, normal)),
+            inputs.bouncinesses[j]);
+        sum += ball.v.x;
+    }
+    return sum;
+}
+
+static float benchUpdateTransform(int numOps)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < numOps; ++i)
+    {
+        Flipper* flipper = &inputs.flippers[i & (benchInputsCount - 1)];
+        updateTransform(flipper);
+        sum += flipper->transform.m[0][0];
+    }
+    return sum;
+}
+
+static float benchLineIntersection(int numOps)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < numOps; ++i)
+    {
+        int j = i & (benchInputsCount - 1);
+        int k = (i + 1) & (benchInputsCount - 1);
+        Line l1{ inputs.linePoints[j], inputs.lineDirections[j] };
+        Line l2{ inputs.linePoints[k], inputs.lineDirections[k] };
+        sum += findIntersection(l1, l2).x;
+    }
+    return sum;
+}
+
+static float benchRayArcIntersection(int numOps)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < numOps; ++i)
+    {
+        int j = i & (benchInputsCount - 1);
+        sum += findIntersection(inputs.rays[j], inputs.arcs[j]).x;
+    }
+    return sum;
+}
+
+static float benchArcLines(int numOps)
+{
+    // 2 * (32 - 1) of them
+    DefaultVertex verts[62];
+    float sum = 0.0f;
+    for (int i = 0; i < numOps; ++i)
+    {
+        addArcLines(verts, inputs.arcs[i & (benchInputsCount - 1)], 32);
+        sum += (float)verts[7].pos[0];
+    }
+    return sum;
+}
+
+struct Benchmark
+{
+    const char* name;
+    float (*run)(int numOps);
+};
+
+static const Benchmark benchmarks[] = {
+    { "checkIntersection/circle_arc", benchArcIntersection },
+    { "checkIntersection/circle_segment", benchSegmentIntersection },
+    { "checkIntersection/circle_flipper", benchFlipperIntersection },
+    { "resolveCollision", benchResolveCollision },
+    { "updateTransform", benchUpdateTransform },
+    { "findIntersection/line_line", benchLineIntersection },
+    { "findIntersection/ray_arc", benchRayArcIntersection },
+    { "addArcLines/32_steps", benchArcLines },
+};
+
+struct BenchResult
+{
+    const char* name;
+    // Fastest of the repeats, the least disturbed by the rest of the machine
+    double minNsPerOp;
+    double medianNsPerOp;
+    int numOpsPerRepeat;
+};
+
+struct BenchOptions
+{
+    const char* filter;
+    double time;
+    int numRepeats;
+    const char* jsonFilename;
+};
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: my_pinball_bench [options]\n"
+        "  --filter S   only run the benchmarks with S in their name\n"
+        "  --time S     seconds to spend on each benchmark (default 0.5)\n"
+        "  --repeats N  timed runs of each benchmark, the fastest and the median are reported (default 5)\n"
+        "  --json F     write the results to F\n");
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions* opts)
+{
+    *opts = {};
+    opts->time = 0.5;
+    opts->numRepeats = 5;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            return false;
+        }
+        ++i;
+
+        if (strcmp(arg, "--filter") == 0)
+        {
+            opts->filter = value;
+        }
+        else if (strcmp(arg, "--time") == 0)
+        {
+            opts->time = atof(value);
+        }
+        else if (strcmp(arg, "--repeats") == 0)
+        {
+            opts->numRepeats = atoi(value);
+        }
+        else if (strcmp(arg, "--json") == 0)
+        {
+            opts->jsonFilename = value;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return opts->time > 0.0 && opts->numRepeats > 0 && opts->numRepeats <= benchRepeatsCap;
+}
+
+static double getSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static BenchResult runBenchmark(const Benchmark* b, const BenchOptions* opts)
+{
+    // Double the calls until a run takes long enough to time, that also warms up the caches
+    int numOps = benchInputsCount;
+    double repeatTime = opts->time / opts->numRepeats;
+    for (;;)
+    {
+        double start = getSeconds();
+        benchSink = benchSink + b->run(numOps);
+        double elapsed = getSeconds() - start;
+        if (elapsed >= repeatTime * 0.5 || numOps >= (1 << 29))
+        {
+            if (elapsed < repeatTime)
+            {
+                double scale = elapsed > 0.0 ? repeatTime / elapsed : 2.0;
+                numOps = (int)std::min((double)numOps * scale, (double)(1 << 30));
+            }
+            break;
+        }
+        numOps *= 2;
+    }
+
+    double nsPerOp[benchRepeatsCap];
+    for (int i = 0; i < opts->numRepeats; ++i)
+    {
+        double start = getSeconds();
+        benchSink = benchSink + b->run(numOps);
+        nsPerOp[i] = (getSeconds() - start) * 1e9 / numOps;
+    }
+    std::sort(nsPerOp, nsPerOp + opts->numRepeats);
+
+    BenchResult result = {};
+    result.name = b->name;
+    result.minNsPerOp = nsPerOp[0];
+    result.medianNsPerOp = nsPerOp[opts->numRepeats / 2];
+    result.numOpsPerRepeat = numOps;
+    return result;
+}
+
+static bool writeJson(const char* filename, const BenchResult* results, int numResults)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+    fprintf(file, "{\n");
+#ifdef NDEBUG
+    fprintf(file, "  \"asserts\": false,\n");
+#else
+    fprintf(file, "  \"asserts\": true,\n");
+#endif
+    fprintf(file, "  \"benchmarks\": [\n");
+    for (int i = 0; i < numResults; ++i)
+    {
+        const BenchResult* r = &results[i];
+        fprintf(file, "    { \"name\": \"%s\", \"ns_per_op\": %.3f, \"median_ns_per_op\": %.3f, \"ops\": %d }%s\n",
+            r->name, r->minNsPerOp, r->medianNsPerOp, r->numOpsPerRepeat, i + 1 < numResults ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    bool isOk = ferror(file) == 0;
+    isOk = fclose(file) == 0 && isOk;
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    return isOk;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions opts;
+    if (!parseOptions(argc, argv, &opts))
+    {
+        printUsage();
+        return 1;
+    }
+
+#ifndef NDEBUG
+    fprintf(stderr, "Asserts are on, build with -DCMAKE_BUILD_TYPE=Release for numbers worth comparing\n");
+#endif
+
+    initInputs();
+
+    constexpr int numBenchmarks = (int)ARRAY_LEN(benchmarks);
+    BenchResult results[numBenchmarks];
+    int numResults = 0;
+
+    printf("%-36s %12s %12s\n", "benchmark", "ns/op", "median");
+    for (int i = 0; i < numBenchmarks; ++i)
+    {
+        if (opts.filter && !strstr(benchmarks[i].name, opts.filter))
+        {
+            continue;
+        }
+        BenchResult r = runBenchmark(&benchmarks[i], &opts);
+        printf("%-36s %12.2f %12.2f\n", r.name, r.minNsPerOp, r.medianNsPerOp);
+        fflush(stdout);
+        results[numResults++] = r;
+    }
+
+    if (opts.jsonFilename && !writeJson(opts.jsonFilename, results, numResults))
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "capture.h"
+#include "trace.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t getFrameSize(const FrameCapture* c)
+{
+    return (size_t)c->width * (size_t)c->height * 4;
+}
+
+static void captureWorker(FrameCapture* c)
+{
+    setTraceThreadName("capture");
+    for (;;)
+    {
+        CapturedFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(c->mutex);
+            c->cond.wait(lock, [c] { return c->queueCount > 0 || c->isStopping; });
+            if (c->queueCount == 0)
+            {
+                return;
+            }
+            frame = c->queue[c->queueHead];
+            c->queueHead = (c->queueHead + 1) % captureQueueCap;
+            --c->queueCount;
+        }
+
+        {
+            TRACE_SCOPE("write frame");
+            c->callback(c->user, frame.pixels, c->width, c->height, frame.frameIndex);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(c->mutex);
+            c->freeBuffers[c->numFreeBuffers++] = frame.pixels;
+        }
+        c->cond.notify_all();
+    }
+}
+
+void initFrameCapture(FrameCapture* c, int width, int height, FrameCallback* callback, void* user, bool canDropFrames)
+{
+    c->width = width;
+    c->height = height;
+    c->callback = callback;
+    c->user = user;
+    c->canDropFrames = canDropFrames;
+
+    glGenBuffers(captureRingSize, c->pbos);
+    for (int i = 0; i < captureRingSize; ++i)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)getFrameSize(c), nullptr, GL_STREAM_READ);
+        c->fences[i] = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    c->nextPbo = 0;
+    c->numPendingPbos = 0;
+
+    for (int i = 0; i < captureQueueCap; ++i)
+    {
+        c->freeBuffers[i] = (unsigned char*)malloc(getFrameSize(c));
+    }
+    c->numFreeBuffers = captureQueueCap;
+    c->queueHead = 0;
+    c->queueCount = 0;
+    c->isStopping = false;
+
+    c->numCapturedFrames = 0;
+    c->numDroppedFrames = 0;
+
+    c->worker = std::thread(captureWorker, c);
+}
+
+// Maps the oldest pixel buffer in flight and queues its pixels for the worker.
+// Returns false if the GPU hasn't finished writing it and we're not allowed to wait.
+static bool collectOldestFrame(FrameCapture* c, bool wait)
+{
+    assert(c->numPendingPbos > 0);
+    int index = (c->nextPbo - c->numPendingPbos + captureRingSize) % captureRingSize;
+
+    GLuint64 timeout = wait ? 1000000000ull : 0ull;
+    GLenum status = glClientWaitSync(c->fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if (status == GL_TIMEOUT_EXPIRED && !wait)
+    {
+        return false;
+    }
+    glDeleteSync(c->fences[index]);
+    c->fences[index] = nullptr;
+    --c->numPendingPbos;
+
+    // Nothing says the GPU is done with the buffer, so its pixels can't be trusted
+    if (status == GL_WAIT_FAILED)
+    {
+        ++c->numDroppedFrames;
+        return true;
+    }
+
+    unsigned char* buffer = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(c->mutex);
+        if (!c->canDropFrames)
+        {
+            c->cond.wait(lock, [c] { return c->numFreeBuffers > 0; });
+        }
+        if (c->numFreeBuffers > 0)
+        {
+            buffer = c->freeBuffers[--c->numFreeBuffers];
+        }
+    }
+
+    if (!buffer)
+    {
+        ++c->numDroppedFrames;
+        return true;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbos[index]);
+    void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)getFrameSize(c), GL_MAP_READ_BIT);
+    if (mapped)
+    {
+        memcpy(buffer, mapped, getFrameSize(c));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(c->mutex);
+        if (mapped)
+        {
+            c->queue[(c->queueHead + c->queueCount) % captureQueueCap] = { buffer, c->pboFrameIndices[index] };
+            ++c->queueCount;
+            ++c->numCapturedFrames;
+        }
+        else
+        {
+            c->freeBuffers[c->numFreeBuffers++] = buffer;
+            ++c->numDroppedFrames;
+        }
+    }
+    c->cond.notify_all();
+
+    return true;
+}
+
+void captureFrame(FrameCapture* c, int x, int y, int frameIndex)
+{
+    TRACE_SCOPE("capture");
+    // Collect whatever the GPU has finished, but keep at least one frame of latency
+    while (c->numPendingPbos > 1 && collectOldestFrame(c, false))
+    {
+    }
+    if (c->numPendingPbos == captureRingSize)
+    {
+        collectOldestFrame(c, true);
+    }
+
+    int index = c->nextPbo;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, c->pbos[index]);
+    glReadPixels(x, y, c->width, c->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    c->fences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    c->pboFrameIndices[index] = frameIndex;
+
+    c->nextPbo = (index + 1) % captureRingSize;
+    ++c->numPendingPbos;
+}
+
+void finishFrameCapture(FrameCapture* c)
+{
+    while (c->numPendingPbos > 0)
+    {
+        collectOldestFrame(c, true);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(c->mutex);
+        c->isStopping = true;
+    }
+    c->cond.notify_all();
+    c->worker.join();
+
+    assert(c->numFreeBuffers == captureQueueCap);
+    for (int i = 0; i < captureQueueCap; ++i)
+    {
+        free(c->freeBuffers[i]);
+    }
+    c->numFreeBuffers = 0;
+
+    glDeleteBuffers(captureRingSize, c->pbos);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Called on the capture worker thread. Pixels are RGBA, rows go bottom to top.
+typedef void FrameCallback(void* user, const unsigned char* pixels, int width, int height, int frameIndex);
+
+constexpr int captureRingSize = 3;
+constexpr int captureQueueCap = 8;
+
+struct CapturedFrame
+{
+    unsigned char* pixels;
+    int frameIndex;
+};
+
+// Reads the framebuffer without stalling the pipeline: every frame is read into the next pixel
+// buffer of a ring and mapped a couple of frames later, when the GPU is done with it. The pixels
+// are then handed to a worker thread.
+struct FrameCapture
+{
+    int width;
+    int height;
+    FrameCallback* callback;
+    void* user;
+    // Drop frames when the worker falls behind instead of waiting for it
+    bool canDropFrames;
+
+    GLuint pbos[captureRingSize];
+    GLsync fences[captureRingSize];
+    int pboFrameIndices[captureRingSize];
+    int nextPbo;
+    int numPendingPbos;
+
+    // Guarded by the mutex
+    unsigned char* freeBuffers[captureQueueCap];
+    int numFreeBuffers;
+    CapturedFrame queue[captureQueueCap];
+    int queueHead;
+    int queueCount;
+    bool isStopping;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread worker;
+
+    int numCapturedFrames;
+    int numDroppedFrames;
+};
+
+// Requires a current OpenGL context
+void initFrameCapture(FrameCapture* c, int width, int height, FrameCallback* callback, void* user, bool canDropFrames);
+
+// Reads width x height pixels at (x, y) of the current read framebuffer, call after rendering and before swapping
+void captureFrame(FrameCapture* c, int x, int y, int frameIndex);
+
+// Waits for the frames in flight and for the worker to finish
+void finishFrameCapture(FrameCapture* c);
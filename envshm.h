@@ -0,0 +1,73 @@
+#pragma once
+
+// Shared memory layout of my_pinball_server (Linux). A trainer maps the object, writes actions into the
+// next slot of a ring and bumps numRequests, the server steps every environment and bumps numResponses.
+// Both counters double as futex words, waiters sleep on them with FUTEX_WAIT (not FUTEX_PRIVATE).
+// Everything is little endian and naturally aligned so it can be mapped from Python with numpy.
+
+#include <stdint.h>
+
+#include <atomic>
+
+constexpr uint32_t envShmMagic = 0x4c425450; // "PTBL"
+constexpr uint32_t envShmVersion = 1;
+
+// Up to envRingSize requests can be in flight
+constexpr uint32_t envRingSize = 4;
+
+// 10 seconds of simulated time, a step asking for more gets this many
+constexpr uint32_t envTicksMax = 1200;
+
+// Bits of an action byte
+constexpr uint8_t envActionLeft = 1;
+constexpr uint8_t envActionRight = 2;
+
+enum EnvCommand : uint32_t
+{
+    // Steps every environment numTicks simulation ticks with its action held down
+    envCommandStep,
+    // Starts every environment over, actions are ignored
+    envCommandReset,
+    envCommandShutdown,
+};
+
+// At the start of each slot. The arrays follow at the offsets in the header, relative to the slot.
+struct EnvSlotHeader
+{
+    uint32_t command;
+    // Up to envTicksMax
+    uint32_t numTicks;
+};
+
+struct EnvShmHeader
+{
+    uint32_t magic;
+    uint32_t version;
+
+    uint32_t numEnvs;
+    uint32_t numFeatures;
+    // 0 when the server doesn't render images
+    uint32_t obsWidth;
+    uint32_t obsHeight;
+
+    // Slot i starts at slotsOffset + i * slotStride
+    uint64_t slotsOffset;
+    uint64_t slotStride;
+
+    // Written by the client: uint8_t action per environment
+    uint64_t actionsOffset;
+    // Written by the server: float features (see ObservationFeature), float reward (score gained),
+    // uint8_t done (the game was over and has been started over) and the grayscale image per environment
+    uint64_t featuresOffset;
+    uint64_t rewardsOffset;
+    uint64_t donesOffset;
+    uint64_t imagesOffset;
+
+    uint64_t totalSize;
+
+    // Request n goes into slot n % envRingSize
+    std::atomic<uint32_t> numRequests;
+    std::atomic<uint32_t> numResponses;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex words must be plain 32-bit integers");
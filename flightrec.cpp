@@ -0,0 +1,142 @@
+#include "flightrec.h"
+
+#include "inputlog.h"
+#include "tablefile.h"
+
+#include <stdio.h>
+
+static void recordTick(void* user, const Game* game)
+{
+    FlightRecorder* recorder = (FlightRecorder*)user;
+    FlightTick* t = &recorder->ticks[recorder->tickIndex];
+    recorder->tickIndex = (recorder->tickIndex + 1) % flightTicksCap;
+    if (recorder->numTicks < flightTicksCap)
+    {
+        ++recorder->numTicks;
+    }
+
+    t->tick = game->numTicks;
+    t->ball = game->ball;
+    for (int i = 0; i < numFlippers; ++i)
+    {
+        t->flipperOrientations[i] = game->flippers[i].orientation;
+    }
+    t->plungerT = game->plungerT;
+    t->score = game->score;
+    t->lives = game->lives;
+}
+
+void initFlightRecorder(FlightRecorder* recorder, Game* game, const char* dumpDir, float budget, uint32_t seed, const Table* table)
+{
+    *recorder = {};
+    recorder->budget = budget;
+    recorder->dumpDir = dumpDir;
+    recorder->seed = seed;
+    recorder->tableChecksum = getTableChecksum(table);
+    recorder->numFramesSinceDump = flightFramesCap;
+
+    game->tickCallback = recordTick;
+    game->tickCallbackUser = recorder;
+}
+
+// Of the i-th oldest of numItems in a ring, nextIndex being where the next one goes
+static int getRingIndex(int nextIndex, int numItems, int cap, int i)
+{
+    return (nextIndex - numItems + i + cap) % cap;
+}
+
+void beginFlightFrame(FlightRecorder* recorder, const Game* game, GameInput input, float wallDt, float frameDt)
+{
+    FlightFrame* f = &recorder->frames[recorder->frameIndex];
+    recorder->frameIndex = (recorder->frameIndex + 1) % flightFramesCap;
+    if (recorder->numFrames < flightFramesCap)
+    {
+        ++recorder->numFrames;
+    }
+
+    *f = {};
+    f->frame = recorder->numRecordedFrames++;
+    f->wallDt = wallDt;
+    f->frameDt = frameDt;
+    f->buttons = (input.isLeftButtonDown ? inputLeftButton : 0u) | (input.isRightButtonDown ? inputRightButton : 0u);
+    f->firstTick = game->numTicks + 1;
+
+    ++recorder->numFramesSinceDump;
+    bool isHitch = wallDt > recorder->budget || wallDt > frameDt;
+    recorder->isDumpPending = isHitch && recorder->numFramesSinceDump >= flightFramesCap && recorder->numDumps < flightDumpsCap;
+}
+
+bool endFlightFrame(FlightRecorder* recorder, const Game* game, const Profiler* profiler)
+{
+    FlightFrame* f = &recorder->frames[getRingIndex(recorder->frameIndex, 1, flightFramesCap, 0)];
+    f->numTicks = (int)(game->numTicks + 1 - f->firstTick);
+    for (int phase = 0; phase < firstGpuProfilePhase; ++phase)
+    {
+        f->phaseTimes[phase] = profiler->phaseTimes[phase][profiler->frameIndex];
+    }
+
+    if (!recorder->isDumpPending)
+    {
+        return false;
+    }
+    recorder->isDumpPending = false;
+    recorder->numFramesSinceDump = 0;
+
+    char filename[1024];
+    snprintf(filename, sizeof filename, "%s/flight_%u_%02d.txt", recorder->dumpDir, recorder->seed, recorder->numDumps++);
+    if (writeFlightRecord(recorder, filename))
+    {
+        printf("Frame %u came %.1f ms after the previous one, wrote %s\n", f->frame, (double)f->wallDt * 1000.0, filename);
+    }
+    return true;
+}
+
+bool writeFlightRecord(const FlightRecorder* recorder, const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+
+    const FlightFrame* last = &recorder->frames[getRingIndex(recorder->frameIndex, 1, flightFramesCap, 0)];
+    fprintf(file, "# Frame %u began %.3f ms after the previous one, the budget is %.3f ms. %.3f ms of simulated time was dropped.\n",
+        last->frame, (double)last->wallDt * 1000.0, (double)recorder->budget * 1000.0,
+        (double)(last->wallDt - last->frameDt) * 1000.0);
+    fprintf(file, "# Seed %u, table checksum %08x, %.6f s ticks\n", recorder->seed, recorder->tableChecksum, (double)simDt);
+
+    // wall_ms is since the previous frame began, so a slow frame shows in the wall_ms of the next row.
+    // The phases are the profiler's.
+    static_assert(firstGpuProfilePhase == 6, "The columns don't match the profile phases");
+    fprintf(file, "\n# frame wall_ms dt_ms buttons first_tick ticks input_ms physics_ms vertices_ms text_ms submit_ms swap_ms\n");
+    for (int i = 0; i < recorder->numFrames; ++i)
+    {
+        const FlightFrame* f = &recorder->frames[getRingIndex(recorder->frameIndex, recorder->numFrames, flightFramesCap, i)];
+        fprintf(file, "%u %.3f %.3f %u %u %d", f->frame, (double)f->wallDt * 1000.0, (double)f->frameDt * 1000.0,
+            f->buttons, f->firstTick, f->numTicks);
+        for (int phase = 0; phase < firstGpuProfilePhase; ++phase)
+        {
+            fprintf(file, " %.3f", (double)f->phaseTimes[phase] * 1000.0);
+        }
+        fprintf(file, "\n");
+    }
+
+    // The state after each tick
+    fprintf(file, "\n# tick ball_x ball_y ball_vx ball_vy left_flipper right_flipper plunger score lives\n");
+    for (int i = 0; i < recorder->numTicks; ++i)
+    {
+        const FlightTick* t = &recorder->ticks[getRingIndex(recorder->tickIndex, recorder->numTicks, flightTicksCap, i)];
+        fprintf(file, "%u %.4f %.4f %.4f %.4f %.4f %.4f %.4f %d %d\n", t->tick, (double)t->ball.p.x, (double)t->ball.p.y,
+            (double)t->ball.v.x, (double)t->ball.v.y, (double)t->flipperOrientations[0], (double)t->flipperOrientations[1],
+            (double)t->plungerT, t->score, t->lives);
+    }
+
+    bool isOk = !ferror(file);
+    isOk = fclose(file) == 0 && isOk;
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    return isOk;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "game.h"
+#include "profiler.h"
+
+// Keeps the last few seconds of the game, the state after every fixed step and the inputs and phase
+// times of every frame, and writes them to a text file when a frame goes over its budget or is long
+// enough for maxDt to drop simulated time. That's what's needed to make sense of a hitch or the ball
+// going through a wall after the fact. Recording copies a few numbers into rings and never allocates.
+
+// About 8.5 seconds of ticks, and of frames at up to 120 Hz
+constexpr int flightTicksCap = 1024;
+constexpr int flightFramesCap = 1024;
+// A run with a bad hitch every frame still only writes this many
+constexpr int flightDumpsCap = 16;
+
+struct FlightTick
+{
+    uint32_t tick;
+    Ball ball;
+    float flipperOrientations[numFlippers];
+    float plungerT;
+    int score;
+    int lives;
+};
+
+struct FlightFrame
+{
+    uint32_t frame;
+    // Since the previous frame, before and after the maxDt clamp
+    float wallDt;
+    float frameDt;
+    uint32_t buttons;
+    // Ticks run by the frame
+    uint32_t firstTick;
+    int numTicks;
+    // The CPU phases of the profiler, in seconds
+    float phaseTimes[firstGpuProfilePhase];
+};
+
+struct FlightRecorder
+{
+    FlightTick ticks[flightTicksCap];
+    int tickIndex;
+    int numTicks;
+
+    FlightFrame frames[flightFramesCap];
+    int frameIndex;
+    int numFrames;
+    uint32_t numRecordedFrames;
+
+    // Frames over it are dumped, in seconds
+    float budget;
+    const char* dumpDir;
+    uint32_t seed;
+    uint32_t tableChecksum;
+
+    // Set by beginFlightFrame() for endFlightFrame()
+    bool isDumpPending;
+    // The frames of one dump aren't written again by the next
+    int numFramesSinceDump;
+    int numDumps;
+};
+
+// Sets the tick callback of the game. dumpDir has to outlive the recorder.
+void initFlightRecorder(FlightRecorder* recorder, Game* game, const char* dumpDir, float budget, uint32_t seed, const Table* table);
+
+// Before updateGame(), with the time since the previous frame before it was clamped
+void beginFlightFrame(FlightRecorder* recorder, const Game* game, GameInput input, float wallDt, float frameDt);
+// After the frame's last profiled phase, writes the dump when the frame is one. Returns whether it did,
+// the time that took shouldn't count against the next frame.
+bool endFlightFrame(FlightRecorder* recorder, const Game* game, const Profiler* profiler);
+
+// Print what went wrong to stderr and return false on failure
+bool writeFlightRecord(const FlightRecorder* recorder, const char* filename);
@@ -0,0 +1,541 @@
+#pragma once
+
+#include "arena.h"
+#include "pinball_math.h"
+
+#include <stdint.h>
+
+#define ARRAY_LEN(arr) (sizeof(arr) / sizeof(arr[0]))
+
+// Ball's radius is 1.0f, everything is measured relative to that
+constexpr float ballRadius = 1.0f;
+
+constexpr float simFps{ 120.0f };
+constexpr float simDt{ 1.0f / simFps };
+constexpr float minFps = 10.0f;
+constexpr float maxDt = 1.0f / minFps;
+
+namespace Constants
+{
+    constexpr float worldSize{ 70.0f };
+    constexpr float worldL{ -worldSize/2.0f };
+    constexpr float worldR{ worldSize/2.0f };
+    constexpr float worldT{ worldSize };
+    constexpr float worldB{ 0.0f };
+}
+
+// Text is laid out in the screen space of this size
+constexpr int scrWidth = 800;
+constexpr int scrHeight = 800;
+
+constexpr Vec3 defCol{ 1.0f, 1.0f, 1.0f };
+constexpr Vec3 auxCol{ 0.5f, 0.5f, 0.5f };
+constexpr Vec3 oneWayWallsColor{ 0.5f, 0.5f, 0.8f };
+constexpr Vec3 highlightCol{ 0.8f, 0.0f, 0.3f };
+
+struct Circle
+{
+    Vec2 p;
+    float r;
+};
+
+struct LineSegment
+{
+    Vec2 p0;
+    Vec2 p1;
+};
+
+struct Arc
+{
+    Vec2 p;
+    float r;
+    float start;
+    float end;
+};
+
+// An arc drawn with numSteps points is numSteps - 1 lines
+inline int getNumArcLineVerts(int numSteps)
+{
+    return 2 * (numSteps - 1);
+}
+
+// Mirror-symmetric walls and arcs keep only the left copy, the right one is implied.
+// That's only possible when the ball can't touch both copies at once.
+inline bool canStoreMirrored(LineSegment s)
+{
+    return fmaxf(s.p0.x, s.p1.x) <= -ballRadius;
+}
+
+inline bool canStoreMirrored(const Arc& arc)
+{
+    return arc.p.x + arc.r <= -ballRadius;
+}
+
+constexpr float maxAngularVelocity{ twoPi * 4.0f };
+
+constexpr float leftFlipperMinAngle{ radians(-38.0f) };
+constexpr float leftFlipperMaxAngle{ radians(33.0f) };
+
+constexpr int numFlippers = 2;
+
+struct Flipper
+{
+    static constexpr float r0{ 1.1f };
+    static constexpr float r1{ 0.7f };
+    static constexpr float width{ 8.0f };
+    static constexpr float d{ width - r0 - r1 };
+
+    Mat3 transform;
+    Vec2 position;
+    float minAngle;
+    float maxAngle;
+    float orientation;
+    float angularVelocity;
+};
+
+struct Ball
+{
+    Vec2 p;
+    Vec2 v;
+};
+
+constexpr float capsuleHalfHeight = 0.7f;
+constexpr float capsuleRadius = 0.2f;
+constexpr int capsuleArcSteps = 4;
+
+constexpr float popBumperRadius = 2.75f;
+
+constexpr float buttonHalfWidth = 1.4f;
+constexpr float buttonHeight = 0.6f;
+
+struct Button
+{
+    Vec2 p;
+    Vec2 n; // normal
+};
+
+struct Ditch
+{
+    LineSegment floor;
+    LineSegment lid;
+};
+
+//
+// Vertex formats
+//
+
+struct Rgba8
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+};
+
+inline uint8_t packUnorm8(float x)
+{
+    return (uint8_t)(clamp(x, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+inline Rgba8 packColor(Vec3 c)
+{
+    return { packUnorm8(c.x), packUnorm8(c.y), packUnorm8(c.z), 255 };
+}
+
+// Vertex positions are stored as 16-bit normalized values covering [-vertexPosRange, vertexPosRange]
+// on both axes, the vertex shader scales them back
+constexpr float vertexPosRange = 128.0f;
+// Positions of a table's primitives and the reach of its arcs stay within this on both axes, leaving room
+// for the bumpers and buttons drawn around them. Anything past vertexPosRange would be drawn clamped.
+constexpr float tableCoordMax = 120.0f;
+
+inline int16_t packSnorm16(float x)
+{
+    float t = clamp(x, -1.0f, 1.0f) * 32767.0f;
+    return (int16_t)(t < 0.0f ? t - 0.5f : t + 0.5f);
+}
+
+// 8 bytes per vertex
+struct DefaultVertex
+{
+    int16_t pos[2];
+    Rgba8 col;
+};
+
+inline DefaultVertex makeVertex(Vec2 p, Vec3 color)
+{
+    return {
+        { packSnorm16(p.x / vertexPosRange), packSnorm16(p.y / vertexPosRange) },
+        packColor(color),
+    };
+}
+
+// 12 bytes per glyph
+struct FontCharInstance
+{
+    int16_t worldOffset[2]; // in pixels
+    Rgba8 color;
+    uint8_t texOffset[2]; // in glyphs
+    uint8_t pad[2];
+};
+
+constexpr float letterSize = 16.0f;
+constexpr int fontRows = 16;
+constexpr int fontCols = 16;
+
+constexpr int textRunCap = 16;
+constexpr int textRunsCap = 24;
+
+// Every text run full, so laying out text can't run out of room
+constexpr int charInstanceCap = textRunsCap * textRunCap;
+
+// Retained piece of text, glyph instances are regenerated only when the string or the color changes
+struct TextRun
+{
+    Vec2 pos;
+    Vec3 color;
+    char str[textRunCap];
+    int len;
+    FontCharInstance instances[textRunCap];
+};
+
+//
+// Model meshes, drawn with a model transform
+//
+
+constexpr int numFlipperCircleSegments1{ 16 };
+constexpr int numFlipperCircleSegments2{ 8 };
+constexpr int numFlipperVerts{ (numFlipperCircleSegments1 + 1) + (numFlipperCircleSegments2 + 1) };
+
+constexpr int numCircleVerts{ 64 };
+
+constexpr int plungerNumSections{ 10 };
+constexpr int numPlungerVerts{ plungerNumSections + 2 };
+
+void makeFlipperVerts(DefaultVertex* verts);
+void makeCircleVerts(DefaultVertex* verts);
+void makePlungerVerts(DefaultVertex* verts);
+
+//
+// Everything needed to draw a frame, independent of the graphics API
+//
+
+constexpr int numCircles = 1;
+constexpr int ditchLidsCap = 2;
+// A circle around each ditch, and the bars of the profiler overlay (see profiler.h)
+constexpr int debugVertsCap = 256;
+
+struct RenderData
+{
+    // Holds the line arrays, sized to the table by initRenderData()
+    Arena arena;
+
+    // The first numMirroredLineVerts are the left half of the symmetric geometry,
+    // they are drawn a second time reflected around Y axis
+    DefaultVertex* staticLineVerts;
+    int numStaticLineVerts;
+    int numMirroredLineVerts;
+
+    // Redrawn every frame, always the same number
+    DefaultVertex* lineVerts;
+    int numLineVerts;
+
+    Circle circles[numCircles];
+    Mat3 flipperTransforms[numFlippers];
+
+    LineSegment ditchLids[ditchLidsCap];
+    int numDitchLids;
+
+    float plungerCenterX;
+    float plungerScaleY;
+
+    DefaultVertex debugVerts[debugVertsCap];
+    int numDebugVerts;
+
+    TextRun textRuns[textRunsCap];
+    int numTextRuns;
+    bool isTextDirty;
+
+    // Incremented every time charInstances are laid out again
+    int textVersion;
+    FontCharInstance charInstances[charInstanceCap];
+    int numChars;
+};
+
+TextRun* addTextRun(RenderData* rd, int x, int y, const char* str = "", Vec3 color = defCol);
+void setText(RenderData* rd, TextRun* run, const char* str, Vec3 color = defCol);
+char* formatInt(char* ptr, int value, int width = 0);
+void layoutText(RenderData* rd);
+
+//
+// Table and game state
+//
+
+// The ditch sequence and the observations are made for two ditches at most
+constexpr int ditchesCap = 2;
+
+// How many of each primitive a table has room for
+struct TableSizes
+{
+    int numBasicWalls;
+    int numMirroredWalls;
+    int numSlingshotWalls;
+    int numOneWayWalls;
+    int numArcs;
+    int numMirroredArcs;
+    int numCapsules;
+    int numPopBumpers;
+    int numButtons;
+    int numDitches;
+};
+
+// The static primitives the collision field sorts into cells, in the order the ball is tested against them
+enum StaticKind
+{
+    staticBasicWall,
+    staticMirroredWall,
+    staticArc,
+    staticMirroredArc,
+    staticCapsule,
+    staticPopBumper,
+    numStaticKinds,
+};
+
+// Square cells over the world, as wide as the ball's radius
+constexpr float fieldCellSize = 1.0f;
+constexpr int fieldCellsPerSide = (int)(Constants::worldSize / fieldCellSize);
+constexpr int numFieldCells = fieldCellsPerSide * fieldCellsPerSide;
+// A primitive is near a cell when the ball can touch it from anywhere in the cell, after being pushed
+// two radii by the other primitives of its kind in the same tick. Half the cell's diagonal plus three radii.
+constexpr float fieldNearDistance = 0.71f * fieldCellSize + 3.0f * ballRadius;
+
+// Made from the static primitives when a table is built or baked, so the ball is only tested against the
+// ones near it and the cost of a tick doesn't grow with the table. Each cell has the distance from its
+// center to the nearest static primitive, mirror images included, and the primitives of each kind that
+// are near it. Distances are truncated at fieldNearDistance, past it the cell has no primitives at all.
+// Ditch lids, slingshots, one-way walls and buttons are few, and move or come and go, so they're always tested.
+struct CollisionField
+{
+    Arena arena;
+
+    float* distances;
+    // The indices of the primitives of a kind near a cell go from starts[cell * numStaticKinds + kind]
+    // to the next start, in increasing order. numFieldCells * numStaticKinds + 1 of them.
+    int32_t* starts;
+    int32_t* indices;
+    int numIndices;
+};
+
+// Static geometry of the table. The arrays are allocated by allocTable() to the sizes of the table
+// being built or loaded, and the counts are filled in as the primitives are added.
+struct Table
+{
+    Arena arena;
+
+    LineSegment* basicWalls;
+    int numBasicWalls;
+
+    // Left halves of mirror-symmetric walls
+    LineSegment* mirroredWalls;
+    int numMirroredWalls;
+
+    LineSegment* slingshotWalls;
+    int numSlingshotWalls;
+
+    LineSegment* oneWayWalls;
+    int numOneWayWalls;
+
+    Arc* arcs;
+    int* arcSteps;
+    int numArcs;
+
+    // Left halves of mirror-symmetric arcs
+    Arc* mirroredArcs;
+    int* mirroredArcSteps;
+    int numMirroredArcs;
+
+    Vec2* capsules;
+    int numCapsules;
+
+    Vec2* popBumpers;
+    int numPopBumpers;
+
+    Button* buttons;
+    int numButtons;
+
+    // Without one, every primitive is tested
+    CollisionField field;
+
+    Ditch ditches[ditchesCap];
+    int numDitches;
+
+    float plungerLeftX;
+    float plungerRightX;
+    float plungerCenterX;
+    float plungerTopY;
+
+    Vec2 initialBallPosition;
+
+    // Bumpers push the ball off harder than it hit them and score on every hit
+    float slingshotBounciness;
+    float popBumperBounciness;
+    float buttonBounciness;
+    int slingshotScore;
+    int popBumperScore;
+    int buttonScore;
+};
+
+struct GameInput
+{
+    bool isLeftButtonDown;
+    bool isRightButtonDown;
+};
+
+enum HighlightKind
+{
+    highlightSlingshot,
+    highlightPopBumper,
+    highlightButton,
+};
+
+struct Highlight
+{
+    int kind;
+    int index;
+    float timer;
+};
+
+constexpr int highlightsCap = 16;
+
+// What the ball bounced off, for the counts of GameStats
+enum CollisionKind
+{
+    collisionFlipper,
+    collisionWall,
+    collisionDitchFloor,
+    collisionDitchLid,
+    collisionSlingshot,
+    collisionOneWayWall,
+    collisionArc,
+    collisionCapsule,
+    collisionPopBumper,
+    collisionButton,
+    numCollisionKinds,
+};
+
+// Totals since initGame()
+struct GameStats
+{
+    // Ticks the ball was pushed out of each kind of primitive, resting on one counts every tick
+    uint32_t numCollisions[numCollisionKinds];
+    uint32_t numBallsLost;
+    // Games that ended, the game starts over by itself after that
+    uint32_t numGamesOver;
+};
+
+// Contacts past this many in a tick aren't kept, the ball rarely touches more than two things at once
+constexpr int tickContactsCap = 8;
+
+struct Game;
+// Called at the end of every fixed step, for tools watching the simulation tick by tick
+typedef void GameTickCallback(void* user, const Game* game);
+
+// libpinball snapshots are this struct as is, bump snapshotVersion in pinball.cpp when it changes
+struct Game
+{
+    const Table* table;
+
+    Ball ball;
+    Flipper flippers[numFlippers];
+
+    float plungerT;
+
+    bool isDitchClosed[ditchesCap];
+    float ditchLaunchTimer;
+    float ditchCloseTimer;
+    int ditchIndexToClose;
+
+    // Bumpers hit in the last second, the oldest is replaced first when full
+    Highlight highlights[highlightsCap];
+    int numHighlights;
+    float ditchFloorHighlightTimers[ditchesCap];
+
+    int highScore;
+    int score;
+    int lives;
+    float livesHighlightTimer;
+
+    bool isGameOver;
+    float gameOverTimer;
+
+    float accum;
+    bool wasLeftButtonDown;
+    bool wasRightButtonDown;
+
+    // xorshift32, so games with the same seed and inputs play out the same on any thread
+    uint32_t randomState;
+
+    // Fixed simulation steps run since initGame()
+    uint32_t numTicks;
+    GameStats stats;
+    // Where the ball touched the table in the last tick
+    Vec2 tickContacts[tickContactsCap];
+    int numTickContacts;
+
+    // Not set by initGame()
+    GameTickCallback* tickCallback;
+    void* tickCallbackUser;
+};
+
+// Text runs of the heads-up display
+struct Hud
+{
+    TextRun* highScoreText;
+    TextRun* scoreText;
+    TextRun* livesLabelText;
+    TextRun* livesText;
+    TextRun* gameOverText;
+    TextRun* frameText;
+};
+
+// Allocates the arrays with room for sizes, the counts start at 0
+void allocTable(Table* table, const TableSizes* sizes);
+void freeTable(Table* table);
+TableSizes getTableSizes(const Table* table);
+
+void buildTable(Table* table);
+// After the primitives are added, replaces the table's field. Prints what went wrong to stderr and
+// returns false when out of memory, the table is left without a field then.
+bool buildCollisionField(Table* table);
+// For numIndices indices, filled in by the caller. Returns false when out of memory.
+bool allocCollisionField(CollisionField* field, int numIndices);
+// Bounciness and scores of the built-in table
+void setDefaultMaterials(Table* table);
+void initGame(Game* game, const Table* table, uint32_t seed);
+// Whether the counts and indices of a game copied in from elsewhere are within its arrays and its table
+bool isGameValid(const Game* game);
+
+// Advances the game by frameDt, running as many fixed simulation steps as fit
+void updateGame(Game* game, GameInput input, float frameDt);
+
+void initRenderData(RenderData* rd, Hud* hud, const Table* table);
+void freeRenderData(RenderData* rd);
+// Vertices the static geometry and the bumpers are drawn with
+int getNumStaticLineVerts(const Table* table);
+int getNumLineVerts(const Table* table);
+
+struct TableReload
+{
+    int numChangedPrimitives;
+    // The range of RenderData::staticLineVerts to upload again
+    int firstChangedVert;
+    int numChangedVerts;
+};
+
+// Swaps in a new version of the table under running games, which keep their state, and takes over its
+// memory. Only the static lines that moved need uploading again, the rest of the render data is filled
+// from the table each frame.
+TableReload reloadTable(Table* table, RenderData* rd, Table* newTable);
+// After reloadTable(), for each game on the table. Drops the highlights of primitives it no longer has.
+void fitGameToTable(Game* game);
+void fillRenderData(RenderData* rd, const Hud* hud, const Game* game);
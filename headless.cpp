@@ -0,0 +1,349 @@
+// Runs the game without a display server. A surfaceless EGL context (Mesa falls back to llvmpipe
+// software rasterization when there's no GPU) drives the same render() path into an offscreen
+// framebuffer, frames can be written out as PPM images or recorded (read back asynchronously, see capture.h).
+
+#include "autoplay.h"
+#include "capture.h"
+#include "game.h"
+#include "recorder.h"
+#include "renderer.h"
+#include "tablefile.h"
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct HeadlessOptions
+{
+    int numFrames;
+    int size;
+    const char* outDir;
+    const char* recordFilename;
+    int writeEvery;
+    unsigned int seed;
+    const char* tableFilename;
+    float frameDt;
+    bool isFinishTiming;
+};
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: my_pinball_headless [options]\n"
+        "  --frames N   number of frames to run (default 600)\n"
+        "  --size N     width and height of the frames in pixels (default 800)\n"
+        "  --out DIR    write frames to DIR/frame_NNNNN.ppm\n"
+        "  --record F   record frames to F, an animated .gif or a .y4m video\n"
+        "  --every N    write every Nth frame (default 1)\n"
+        "  --seed N     random seed (default 1)\n"
+        "  --table F    load the table from F, a text or baked table (see tablefile.h)\n"
+        "  --fps N      simulated frame rate (default 60)\n"
+        "  --gpu-timing queries|finish\n"
+        "               time the draw groups with timer queries (default) or between glFinish calls,\n"
+        "               which software drivers like llvmpipe need\n");
+}
+
+static bool parseOptions(int argc, char** argv, HeadlessOptions* opts)
+{
+    *opts = {};
+    opts->numFrames = 600;
+    opts->size = 800;
+    opts->writeEvery = 1;
+    opts->seed = 1;
+    opts->frameDt = 1.0f / 60.0f;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            return false;
+        }
+        ++i;
+
+        if (strcmp(arg, "--frames") == 0)
+        {
+            opts->numFrames = atoi(value);
+        }
+        else if (strcmp(arg, "--size") == 0)
+        {
+            opts->size = atoi(value);
+        }
+        else if (strcmp(arg, "--out") == 0)
+        {
+            opts->outDir = value;
+        }
+        else if (strcmp(arg, "--record") == 0)
+        {
+            opts->recordFilename = value;
+        }
+        else if (strcmp(arg, "--every") == 0)
+        {
+            opts->writeEvery = atoi(value);
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            opts->seed = (unsigned int)strtoul(value, nullptr, 10);
+        }
+        else if (strcmp(arg, "--table") == 0)
+        {
+            opts->tableFilename = value;
+        }
+        else if (strcmp(arg, "--fps") == 0)
+        {
+            opts->frameDt = 1.0f / (float)atof(value);
+        }
+        else if (strcmp(arg, "--gpu-timing") == 0)
+        {
+            if (strcmp(value, "finish") != 0 && strcmp(value, "queries") != 0)
+            {
+                return false;
+            }
+            opts->isFinishTiming = strcmp(value, "finish") == 0;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return opts->numFrames > 0 && opts->size > 0 && opts->writeEvery > 0 && opts->frameDt > 0.0f;
+}
+
+struct FrameOutput
+{
+    const char* outDir;
+    Recorder* recorder;
+    int writeEvery;
+};
+
+// Runs on the capture worker thread
+static void writeFrame(void* user, const unsigned char* pixels, int width, int height, int frameIndex)
+{
+    const FrameOutput* output = (const FrameOutput*)user;
+    if (output->outDir)
+    {
+        char filename[1024];
+        snprintf(filename, sizeof filename, "%s/frame_%05d.ppm", output->outDir, frameIndex);
+        writePpm(filename, pixels, width, height);
+    }
+    if (output->recorder)
+    {
+        recordFrame(output->recorder, pixels, frameIndex / output->writeEvery);
+    }
+}
+
+static double getSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+    HeadlessOptions opts;
+    if (!parseOptions(argc, argv, &opts))
+    {
+        printUsage();
+        return 1;
+    }
+
+    //
+    // Create a surfaceless OpenGL context
+    //
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+    {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+        {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (display == EGL_NO_DISPLAY)
+        {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+    }
+
+    EGLint eglMajor, eglMinor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+    {
+        fprintf(stderr, "Failed to initialize EGL\n");
+        return 1;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        fprintf(stderr, "EGL doesn't support desktop OpenGL\n");
+        return 1;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 1,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    // The context is never bound to a surface, so no config is needed (EGL_KHR_no_config_context)
+    EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT)
+    {
+        fprintf(stderr, "Failed to create OpenGL 4.1 context: 0x%x\n", eglGetError());
+        return 1;
+    }
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        fprintf(stderr, "Failed to make the context current: 0x%x\n", eglGetError());
+        return 1;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress))
+    {
+        fprintf(stderr, "Failed to initialize GLAD\n");
+        return 1;
+    }
+
+    enableGlDebugOutput();
+
+    printf("Renderer: %s, OpenGL %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+    // There's no default framebuffer without a surface
+    GLuint colorRbo;
+    glGenRenderbuffers(1, &colorRbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, opts.size, opts.size);
+
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRbo);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "Offscreen framebuffer is incomplete\n");
+        return 1;
+    }
+    glViewport(0, 0, opts.size, opts.size);
+
+    //
+    // Run the game
+    //
+
+    Table table;
+    if (!initTable(&table, opts.tableFilename))
+    {
+        return 1;
+    }
+
+    Game game;
+    initGame(&game, &table, opts.seed);
+
+    RenderData* rd = (RenderData*)malloc(sizeof(RenderData));
+    Hud hud;
+    initRenderData(rd, &hud, &table);
+
+    Renderer renderer;
+    initRenderer(&renderer, rd);
+    renderer.isFinishTiming = opts.isFinishTiming;
+    bool isGpuTimingMeaningless = !opts.isFinishTiming && isSoftwareRenderer();
+
+    Recorder recorder;
+    FrameOutput output = {};
+    output.outDir = opts.outDir;
+    output.writeEvery = opts.writeEvery;
+    if (opts.recordFilename)
+    {
+        float recordFps = 1.0f / (opts.frameDt * (float)opts.writeEvery);
+        if (!initRecorder(&recorder, opts.recordFilename, opts.size, opts.size, recordFps))
+        {
+            return 1;
+        }
+        output.recorder = &recorder;
+    }
+
+    bool isCapturing = opts.outDir || opts.recordFilename;
+    FrameCapture capture;
+    if (isCapturing)
+    {
+        initFrameCapture(&capture, opts.size, opts.size, writeFrame, &output, false);
+    }
+
+    double startTime = getSeconds();
+
+    // Of the frames whose timer queries were read back
+    double gpuTimes[numGpuTimerGroups] = {};
+    int numGpuTimedFrames = 0;
+
+    for (int frameIndex = 0; frameIndex < opts.numFrames; ++frameIndex)
+    {
+        GameInput input = getAutoplayInput(&game, frameIndex);
+        updateGame(&game, input, opts.frameDt);
+
+        fillRenderData(rd, &hud, &game);
+        render(&renderer, rd);
+        if (renderer.hasGpuTimes)
+        {
+            for (int group = 0; group < numGpuTimerGroups; ++group)
+            {
+                gpuTimes[group] += renderer.gpuTimes[group];
+            }
+            ++numGpuTimedFrames;
+        }
+
+        if (isCapturing && frameIndex % opts.writeEvery == 0)
+        {
+            captureFrame(&capture, 0, 0, frameIndex);
+        }
+    }
+
+    int numWrittenFrames = 0;
+    int numDroppedFrames = 0;
+    if (isCapturing)
+    {
+        finishFrameCapture(&capture);
+        numWrittenFrames = capture.numCapturedFrames;
+        numDroppedFrames = capture.numDroppedFrames;
+    }
+    if (output.recorder)
+    {
+        finishRecorder(&recorder);
+    }
+
+    glFinish();
+    double elapsed = getSeconds() - startTime;
+
+    printf("%d frames (%d written, %d dropped) in %.3f s, %.1f frames/s, score %d\n",
+        opts.numFrames, numWrittenFrames, numDroppedFrames, elapsed, opts.numFrames / elapsed, game.score);
+    if (numGpuTimedFrames > 0)
+    {
+        static const char* const groupNames[numGpuTimerGroups] = { "circles", "flippers", "lines", "ditch lids", "plunger", "debug", "text" };
+        printf("GPU us per frame (%d frames timed%s):", numGpuTimedFrames, opts.isFinishTiming ? " between glFinish calls" : "");
+        for (int group = 0; group < numGpuTimerGroups; ++group)
+        {
+            printf(" %s %.1f", groupNames[group], gpuTimes[group] * 1e6 / numGpuTimedFrames);
+        }
+        printf("\n");
+        if (isGpuTimingMeaningless)
+        {
+            printf("The renderer rasterizes on the CPU when the frame is flushed, so the timer queries bracket no\n"
+                "work and the times above don't attribute anything. Use --gpu-timing finish.\n");
+        }
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+
+    freeRenderData(rd);
+    free(rd);
+    freeTable(&table);
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "heatmap.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// What the screen shows, the view shifts the table left to make room for the HUD (see softraster.cpp)
+constexpr float heatmapMinX = Constants::worldL + 10.0f;
+constexpr float heatmapMinY = Constants::worldB;
+constexpr float heatmapCellSize = Constants::worldSize / (float)heatmapSize;
+
+constexpr size_t heatmapCells = (size_t)heatmapSize * (size_t)heatmapSize;
+
+bool initHeatmap(Heatmap* heatmap)
+{
+    *heatmap = {};
+    heatmap->occupancy = (uint64_t*)calloc(heatmapCells, sizeof(uint64_t));
+    heatmap->contacts = (uint64_t*)calloc(heatmapCells, sizeof(uint64_t));
+    if (!heatmap->occupancy || !heatmap->contacts)
+    {
+        fprintf(stderr, "Out of memory for the heatmap\n");
+        freeHeatmap(heatmap);
+        return false;
+    }
+    return true;
+}
+
+void freeHeatmap(Heatmap* heatmap)
+{
+    free(heatmap->occupancy);
+    free(heatmap->contacts);
+    *heatmap = {};
+}
+
+// Outside the grid is -1, the ball falling off the table for one
+static int getHeatmapCell(Vec2 p)
+{
+    float x = (p.x - heatmapMinX) / heatmapCellSize;
+    float y = (p.y - heatmapMinY) / heatmapCellSize;
+    if (x < 0.0f || y < 0.0f || x >= (float)heatmapSize || y >= (float)heatmapSize)
+    {
+        return -1;
+    }
+    return (int)y * heatmapSize + (int)x;
+}
+
+void addHeatmapTick(Heatmap* heatmap, const Game* game)
+{
+    ++heatmap->numTicks;
+    int cell = getHeatmapCell(game->ball.p);
+    if (cell >= 0)
+    {
+        ++heatmap->occupancy[cell];
+    }
+    for (int i = 0; i < game->numTickContacts; ++i)
+    {
+        cell = getHeatmapCell(game->tickContacts[i]);
+        if (cell >= 0)
+        {
+            ++heatmap->contacts[cell];
+            ++heatmap->numContacts;
+        }
+    }
+}
+
+void countHeatmapTick(void* heatmap, const Game* game)
+{
+    addHeatmapTick((Heatmap*)heatmap, game);
+}
+
+void mergeHeatmap(Heatmap* dst, const Heatmap* src)
+{
+    for (size_t i = 0; i < heatmapCells; ++i)
+    {
+        dst->occupancy[i] += src->occupancy[i];
+        dst->contacts[i] += src->contacts[i];
+    }
+    dst->numTicks += src->numTicks;
+    dst->numContacts += src->numContacts;
+}
+
+bool writeHeatmap(const Heatmap* heatmap, const char* filename)
+{
+    HeatmapHeader header = {};
+    header.magic = heatmapMagic;
+    header.version = heatmapVersion;
+    header.size = heatmapSize;
+    header.minX = heatmapMinX;
+    header.minY = heatmapMinY;
+    header.cellSize = heatmapCellSize;
+    header.numTicks = heatmap->numTicks;
+    header.numContacts = heatmap->numContacts;
+
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+    bool isOk = fwrite(&header, sizeof header, 1, file) == 1 &&
+        fwrite(heatmap->occupancy, sizeof(uint64_t), heatmapCells, file) == heatmapCells &&
+        fwrite(heatmap->contacts, sizeof(uint64_t), heatmapCells, file) == heatmapCells;
+    isOk = fclose(file) == 0 && isOk;
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    return isOk;
+}
+
+void drawHeatmap(const uint64_t* counts, unsigned char* rgba, int width, int height)
+{
+    uint64_t maxCount = 0;
+    for (size_t i = 0; i < heatmapCells; ++i)
+    {
+        maxCount = counts[i] > maxCount ? counts[i] : maxCount;
+    }
+    if (maxCount == 0)
+    {
+        return;
+    }
+
+    constexpr float alpha = 0.7f;
+    float logMax = logf(1.0f + (float)maxCount);
+    for (int y = 0; y < height; ++y)
+    {
+        const uint64_t* row = counts + (size_t)(y * heatmapSize / height) * (size_t)heatmapSize;
+        for (int x = 0; x < width; ++x)
+        {
+            uint64_t count = row[x * heatmapSize / width];
+            if (count == 0)
+            {
+                continue;
+            }
+            float t = logf(1.0f + (float)count) / logMax;
+            float heat[3] = { t, 1.0f - fabsf(2.0f * t - 1.0f), 1.0f - t };
+            unsigned char* pixel = rgba + ((size_t)y * (size_t)width + (size_t)x) * 4;
+            for (int c = 0; c < 3; ++c)
+            {
+                pixel[c] = (unsigned char)((1.0f - alpha) * (float)pixel[c] + alpha * 255.0f * heat[c]);
+            }
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "game.h"
+
+// Where the ball spends its time and where it touches the table, counted every tick into grids over the
+// area the screen shows. For table designers looking for dead zones and drains over many played games.
+// Each thread counts into a heatmap of its own and they're added together at the end, so there's
+// nothing to lock, and counting a tick is a couple of increments.
+
+// Cells of each grid on a side
+constexpr int heatmapSize = 256;
+
+struct Heatmap
+{
+    // heatmapSize x heatmapSize, rows bottom to top
+    uint64_t* occupancy;
+    uint64_t* contacts;
+    uint64_t numTicks;
+    uint64_t numContacts;
+};
+
+// The file written by writeHeatmap(): the header, then the occupancy and the contact grids as uint64,
+// rows bottom to top. Cell (x, y) starts at (minX + x * cellSize, minY + y * cellSize) in the world.
+constexpr uint32_t heatmapMagic = 0x54414548; // "HEAT"
+constexpr uint32_t heatmapVersion = 1;
+
+struct HeatmapHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    float minX;
+    float minY;
+    float cellSize;
+    uint64_t numTicks;
+    uint64_t numContacts;
+};
+
+// Prints what went wrong to stderr and returns false when out of memory
+bool initHeatmap(Heatmap* heatmap);
+void freeHeatmap(Heatmap* heatmap);
+
+// The ball and the contacts of the game's last tick
+void addHeatmapTick(Heatmap* heatmap, const Game* game);
+// A GameTickCallback, with the heatmap as the user pointer
+void countHeatmapTick(void* heatmap, const Game* game);
+void mergeHeatmap(Heatmap* dst, const Heatmap* src);
+
+// Print what went wrong to stderr and return false on failure
+bool writeHeatmap(const Heatmap* heatmap, const char* filename);
+
+// Blends a grid over an image of the screen (rows bottom to top, RGBA) from blue for the least visited
+// cells to red for the most, on a log scale. Cells never visited are left alone.
+void drawHeatmap(const uint64_t* counts, unsigned char* rgba, int width, int height);
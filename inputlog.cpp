@@ -0,0 +1,118 @@
+#include "inputlog.h"
+
+#include "tablefile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void initInputLog(InputLog* log, uint32_t seed, const Table* table)
+{
+    *log = {};
+    log->seed = seed;
+    log->tableChecksum = getTableChecksum(table);
+}
+
+void freeInputLog(InputLog* log)
+{
+    free(log->frames);
+    *log = {};
+}
+
+void addInputFrame(InputLog* log, GameInput input, float frameDt)
+{
+    if (log->numFrames == log->framesCap)
+    {
+        // An hour at 60 frames per second is 2 MB
+        log->framesCap = log->framesCap ? log->framesCap * 2 : 4096;
+        log->frames = (InputFrame*)realloc(log->frames, (size_t)log->framesCap * sizeof(InputFrame));
+    }
+    InputFrame* frame = &log->frames[log->numFrames++];
+    frame->frameDt = frameDt;
+    frame->buttons = (input.isLeftButtonDown ? inputLeftButton : 0u) | (input.isRightButtonDown ? inputRightButton : 0u);
+}
+
+GameInput getFrameInput(const InputFrame* frame)
+{
+    GameInput input = {};
+    input.isLeftButtonDown = (frame->buttons & inputLeftButton) != 0;
+    input.isRightButtonDown = (frame->buttons & inputRightButton) != 0;
+    return input;
+}
+
+bool writeInputLog(const InputLog* log, const char* filename)
+{
+    InputLogHeader header = {};
+    header.magic = inputLogMagic;
+    header.version = inputLogVersion;
+    header.seed = log->seed;
+    header.tableChecksum = log->tableChecksum;
+    header.numFrames = (uint32_t)log->numFrames;
+
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+    bool isOk = fwrite(&header, sizeof header, 1, file) == 1 &&
+        (log->numFrames == 0 || fwrite(log->frames, sizeof(InputFrame), (size_t)log->numFrames, file) == (size_t)log->numFrames);
+    isOk = fclose(file) == 0 && isOk;
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    return isOk;
+}
+
+bool loadInputLog(InputLog* log, const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        return false;
+    }
+
+    InputLogHeader header;
+    if (fread(&header, sizeof header, 1, file) != 1 || header.magic != inputLogMagic)
+    {
+        fprintf(stderr, "%s is not an input log\n", filename);
+        fclose(file);
+        return false;
+    }
+    if (header.version != inputLogVersion)
+    {
+        fprintf(stderr, "%s was recorded by another version of my_pinball\n", filename);
+        fclose(file);
+        return false;
+    }
+    if (header.numFrames > (uint32_t)(1 << 30) / sizeof(InputFrame))
+    {
+        fprintf(stderr, "%s is damaged\n", filename);
+        fclose(file);
+        return false;
+    }
+
+    *log = {};
+    log->seed = header.seed;
+    log->tableChecksum = header.tableChecksum;
+    log->numFrames = (int)header.numFrames;
+    log->framesCap = log->numFrames;
+    log->frames = (InputFrame*)malloc((size_t)log->framesCap * sizeof(InputFrame) + 1);
+    bool isOk = fread(log->frames, sizeof(InputFrame), (size_t)log->numFrames, file) == (size_t)log->numFrames;
+    fclose(file);
+
+    // Frame lengths out of range would make the game run for ever or not at all
+    for (int i = 0; i < log->numFrames && isOk; ++i)
+    {
+        float frameDt = log->frames[i].frameDt;
+        isOk = frameDt >= 0.0f && frameDt <= maxDt;
+    }
+    if (!isOk)
+    {
+        fprintf(stderr, "%s is damaged\n", filename);
+        freeInputLog(log);
+    }
+    return isOk;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "game.h"
+
+// The inputs of a play session, enough to play it again: the game is deterministic given its seed, the
+// table and the buttons and length of every frame. Written by my_pinball --record-inputs and replayed by
+// my_pinball_throughput. A binary file, the header followed by the frames.
+
+constexpr uint32_t inputLogMagic = 0x4e494250; // "PBIN"
+constexpr uint32_t inputLogVersion = 1;
+
+struct InputLogHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seed;
+    // getTableChecksum() of the table it was played on, reloads while playing aren't recorded
+    uint32_t tableChecksum;
+    uint32_t numFrames;
+};
+
+// Bits of InputFrame::buttons
+constexpr uint32_t inputLeftButton = 1;
+constexpr uint32_t inputRightButton = 2;
+
+struct InputFrame
+{
+    float frameDt;
+    uint32_t buttons;
+};
+
+struct InputLog
+{
+    uint32_t seed;
+    uint32_t tableChecksum;
+    InputFrame* frames;
+    int numFrames;
+    int framesCap;
+};
+
+void initInputLog(InputLog* log, uint32_t seed, const Table* table);
+void freeInputLog(InputLog* log);
+void addInputFrame(InputLog* log, GameInput input, float frameDt);
+GameInput getFrameInput(const InputFrame* frame);
+
+// Print what went wrong to stderr and return false on failure
+bool writeInputLog(const InputLog* log, const char* filename);
+bool loadInputLog(InputLog* log, const char* filename);
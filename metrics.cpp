@@ -0,0 +1,260 @@
+#include "metrics.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// A busy agent doesn't get to hold up the frame
+constexpr int metricsConnectionsPerUpdateCap = 4;
+
+static const char* const collisionKindNames[numCollisionKinds] = {
+    "flipper", "wall", "ditch_floor", "ditch_lid", "slingshot", "one_way_wall", "arc", "capsule", "pop_bumper", "button",
+};
+
+static bool writeMetricsFile(const char* filename, const char* text, int len);
+
+static void metricsFileWriter(Metrics* metrics)
+{
+    char text[metricsTextCap];
+    for (;;)
+    {
+        int len;
+        {
+            std::unique_lock<std::mutex> lock(metrics->fileMutex);
+            metrics->fileCond.wait(lock, [metrics] { return metrics->fileTextLen > 0 || metrics->isStopping; });
+            if (metrics->fileTextLen == 0)
+            {
+                return;
+            }
+            len = metrics->fileTextLen;
+            memcpy(text, metrics->fileText, (size_t)len);
+            metrics->fileTextLen = 0;
+        }
+        // Tried again at the next interval
+        writeMetricsFile(metrics->filename, text, len);
+    }
+}
+
+bool initMetrics(Metrics* metrics, const char* socketPath, const char* filename)
+{
+    metrics->numFrames = 0;
+    metrics->numClampedFrames = 0;
+    metrics->droppedSeconds = 0.0;
+    memset(metrics->frameTimeCounts, 0, sizeof metrics->frameTimeCounts);
+    metrics->frameTimeSum = 0.0;
+    metrics->listenFd = -1;
+    metrics->socketPath[0] = '\0';
+    metrics->filename = filename;
+    metrics->nextWriteTime = 0.0;
+    metrics->text[0] = '\0';
+    metrics->fileTextLen = 0;
+    metrics->isStopping = false;
+
+    if (!socketPath)
+    {
+        if (filename)
+        {
+            metrics->fileWriter = std::thread(metricsFileWriter, metrics);
+        }
+        return true;
+    }
+#ifdef __linux__
+    if (strlen(socketPath) + 1 > sizeof metrics->socketPath)
+    {
+        fprintf(stderr, "The metrics socket path %s is too long\n", socketPath);
+        return false;
+    }
+    strcpy(metrics->socketPath, socketPath);
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+
+    // Left behind when the game didn't exit cleanly
+    unlink(socketPath);
+    metrics->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (metrics->listenFd < 0 || bind(metrics->listenFd, (const sockaddr*)&addr, sizeof addr) < 0 ||
+        listen(metrics->listenFd, metricsConnectionsPerUpdateCap) < 0)
+    {
+        fprintf(stderr, "Failed to listen on %s: %s\n", socketPath, strerror(errno));
+        freeMetrics(metrics);
+        return false;
+    }
+    if (filename)
+    {
+        metrics->fileWriter = std::thread(metricsFileWriter, metrics);
+    }
+    return true;
+#else
+    fprintf(stderr, "The metrics socket needs Linux, write them to a file instead\n");
+    return false;
+#endif
+}
+
+void freeMetrics(Metrics* metrics)
+{
+    if (metrics->fileWriter.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(metrics->fileMutex);
+            metrics->isStopping = true;
+        }
+        metrics->fileCond.notify_one();
+        metrics->fileWriter.join();
+    }
+#ifdef __linux__
+    if (metrics->listenFd >= 0)
+    {
+        close(metrics->listenFd);
+        unlink(metrics->socketPath);
+    }
+#endif
+    metrics->listenFd = -1;
+}
+
+void addMetricsFrame(Metrics* metrics, float wallDt, float frameDt)
+{
+    ++metrics->numFrames;
+    if (wallDt > frameDt)
+    {
+        ++metrics->numClampedFrames;
+        metrics->droppedSeconds += (double)(wallDt - frameDt);
+    }
+
+    int bucket = 0;
+    while (bucket < numMetricsFrameTimeBounds && wallDt > metricsFrameTimeBounds[bucket])
+    {
+        ++bucket;
+    }
+    ++metrics->frameTimeCounts[bucket];
+    metrics->frameTimeSum += (double)wallDt;
+}
+
+static void appendText(Metrics* metrics, int* len, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(metrics->text + *len, (size_t)(metricsTextCap - *len), format, args);
+    va_end(args);
+    if (n > 0)
+    {
+        *len = *len + n < metricsTextCap ? *len + n : metricsTextCap - 1;
+    }
+}
+
+static void appendHeader(Metrics* metrics, int* len, const char* name, const char* type, const char* help)
+{
+    appendText(metrics, len, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+int formatMetrics(Metrics* metrics, const Game* game)
+{
+    int len = 0;
+    metrics->text[0] = '\0';
+
+    appendHeader(metrics, &len, "pinball_frames_total", "counter", "Frames rendered.");
+    appendText(metrics, &len, "pinball_frames_total %llu\n", (unsigned long long)metrics->numFrames);
+    appendHeader(metrics, &len, "pinball_ticks_total", "counter", "Fixed simulation steps run.");
+    appendText(metrics, &len, "pinball_ticks_total %u\n", game->numTicks);
+    appendHeader(metrics, &len, "pinball_clamped_frames_total", "counter", "Frames that came later than maxDt after the previous one.");
+    appendText(metrics, &len, "pinball_clamped_frames_total %llu\n", (unsigned long long)metrics->numClampedFrames);
+    appendHeader(metrics, &len, "pinball_dropped_seconds_total", "counter", "Simulated time lost to the maxDt clamp.");
+    appendText(metrics, &len, "pinball_dropped_seconds_total %.6f\n", metrics->droppedSeconds);
+
+    appendHeader(metrics, &len, "pinball_frame_seconds", "histogram", "Time between the starts of consecutive frames.");
+    uint64_t count = 0;
+    for (int i = 0; i < numMetricsFrameTimeBounds; ++i)
+    {
+        count += metrics->frameTimeCounts[i];
+        appendText(metrics, &len, "pinball_frame_seconds_bucket{le=\"%g\"} %llu\n", (double)metricsFrameTimeBounds[i], (unsigned long long)count);
+    }
+    count += metrics->frameTimeCounts[numMetricsFrameTimeBounds];
+    appendText(metrics, &len, "pinball_frame_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)count);
+    appendText(metrics, &len, "pinball_frame_seconds_sum %.6f\n", metrics->frameTimeSum);
+    appendText(metrics, &len, "pinball_frame_seconds_count %llu\n", (unsigned long long)count);
+
+    appendHeader(metrics, &len, "pinball_collisions_total", "counter", "Ticks the ball was pushed out of a primitive, by its kind.");
+    for (int kind = 0; kind < numCollisionKinds; ++kind)
+    {
+        appendText(metrics, &len, "pinball_collisions_total{primitive=\"%s\"} %u\n", collisionKindNames[kind], game->stats.numCollisions[kind]);
+    }
+    appendHeader(metrics, &len, "pinball_balls_lost_total", "counter", "Balls that fell off the table.");
+    appendText(metrics, &len, "pinball_balls_lost_total %u\n", game->stats.numBallsLost);
+    appendHeader(metrics, &len, "pinball_games_played_total", "counter", "Games played to the end.");
+    appendText(metrics, &len, "pinball_games_played_total %u\n", game->stats.numGamesOver);
+
+    return len;
+}
+
+// On the file writer thread
+static bool writeMetricsFile(const char* filename, const char* text, int len)
+{
+    // Renamed over the old one, a reader never sees half a file
+    char tmpFilename[1024];
+    snprintf(tmpFilename, sizeof tmpFilename, "%s.tmp", filename);
+    FILE* file = fopen(tmpFilename, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", tmpFilename);
+        return false;
+    }
+    bool isOk = fwrite(text, 1, (size_t)len, file) == (size_t)len;
+    isOk = fclose(file) == 0 && isOk;
+#ifdef _WIN32
+    remove(filename);
+#endif
+    isOk = isOk && rename(tmpFilename, filename) == 0;
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    return isOk;
+}
+
+void updateMetrics(Metrics* metrics, const Game* game, double time)
+{
+    bool isFormatted = false;
+    int len = 0;
+
+#ifdef __linux__
+    for (int i = 0; metrics->listenFd >= 0 && i < metricsConnectionsPerUpdateCap; ++i)
+    {
+        int fd = accept4(metrics->listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            break;
+        }
+        if (!isFormatted)
+        {
+            len = formatMetrics(metrics, game);
+            isFormatted = true;
+        }
+        // All of it fits in the socket buffer, an agent that doesn't read just gets less
+        send(fd, metrics->text, (size_t)len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        close(fd);
+    }
+#endif
+
+    if (metrics->filename && time >= metrics->nextWriteTime)
+    {
+        metrics->nextWriteTime = time + metricsWriteInterval;
+        if (!isFormatted)
+        {
+            len = formatMetrics(metrics, game);
+        }
+        // Held by the writer only to copy the text out. A text it hasn't got to yet is replaced.
+        {
+            std::lock_guard<std::mutex> lock(metrics->fileMutex);
+            memcpy(metrics->fileText, metrics->text, (size_t)len);
+            metrics->fileTextLen = len;
+        }
+        metrics->fileCond.notify_one();
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "game.h"
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Counters and a frame time histogram of my_pinball in the Prometheus text format, for a monitoring agent
+// to pick up. Either every connection to a Unix socket gets the current values and is closed (Linux only),
+// or a file is rewritten every few seconds by renaming a new one over it. updateMetrics() answers the
+// socket between frames without blocking, and hands the file's text to a thread of its own, so a slow
+// disk doesn't hold up a frame.
+
+// Upper bounds of the frame time buckets, in seconds. Around 60 Hz and its multiples, and the maxDt clamp.
+constexpr float metricsFrameTimeBounds[] = { 0.005f, 0.0105f, 0.0175f, 0.025f, 0.034f, 0.05f, 0.1f, 0.25f };
+constexpr int numMetricsFrameTimeBounds = sizeof metricsFrameTimeBounds / sizeof metricsFrameTimeBounds[0];
+
+constexpr double metricsWriteInterval = 5.0;
+constexpr int metricsTextCap = 8192;
+
+struct Metrics
+{
+    uint64_t numFrames;
+    // Frames that hit the maxDt clamp and the simulated time they lost
+    uint64_t numClampedFrames;
+    double droppedSeconds;
+    // The last one is the +Inf bucket, not cumulative, formatMetrics() adds them up
+    uint64_t frameTimeCounts[numMetricsFrameTimeBounds + 1];
+    double frameTimeSum;
+
+    int listenFd;
+    char socketPath[108];
+    const char* filename;
+    double nextWriteTime;
+
+    char text[metricsTextCap];
+
+    // The file writer waits for fileTextLen to turn non-zero
+    std::thread fileWriter;
+    std::mutex fileMutex;
+    std::condition_variable fileCond;
+    char fileText[metricsTextCap];
+    int fileTextLen;
+    bool isStopping;
+};
+
+// Either can be null. Prints what went wrong to stderr and returns false on failure. The file writer is
+// started when there's a filename, freeMetrics() waits for it to write the last text it was given.
+bool initMetrics(Metrics* metrics, const char* socketPath, const char* filename);
+void freeMetrics(Metrics* metrics);
+
+// With the time since the previous frame before and after the maxDt clamp
+void addMetricsFrame(Metrics* metrics, float wallDt, float frameDt);
+// Answers the connections waiting on the socket, writes the file when it's time. Monotonic seconds.
+void updateMetrics(Metrics* metrics, const Game* game, double time);
+
+// Into metrics->text, returns the length
+int formatMetrics(Metrics* metrics, const Game* game);
@@ -0,0 +1,242 @@
+#include "observation.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+static Vec2 unpackVertexPos(const DefaultVertex& v)
+{
+    return {
+        (float)v.pos[0] / 32767.0f * vertexPosRange,
+        (float)v.pos[1] / 32767.0f * vertexPosRange,
+    };
+}
+
+static Vec2 worldToPixel(const ObservationRenderer* r, Vec2 p)
+{
+    return { (p.x - r->origin.x) * r->scale, (r->origin.y - p.y) * r->scale };
+}
+
+// One pixel per pixel center crossed along the major axis, clipped to the image
+static void drawLine(uint8_t* pixels, int width, int height, Vec2 a, Vec2 b, uint8_t value)
+{
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+
+    bool isXMajor = fabsf(dx) >= fabsf(dy);
+    if (!isXMajor)
+    {
+        std::swap(a.x, a.y);
+        std::swap(b.x, b.y);
+        std::swap(dx, dy);
+    }
+    if (dx == 0.0f)
+    {
+        return;
+    }
+
+    float slope = dy / dx;
+    int majorSize = isXMajor ? width : height;
+    int minorSize = isXMajor ? height : width;
+    int first = std::max((int)ceilf(fminf(a.x, b.x) - 0.5f), 0);
+    int last = std::min((int)ceilf(fmaxf(a.x, b.x) - 0.5f) - 1, majorSize - 1);
+
+    for (int i = first; i <= last; ++i)
+    {
+        int j = (int)floorf(a.y + ((float)i + 0.5f - a.x) * slope);
+        if (j < 0 || j >= minorSize)
+        {
+            continue;
+        }
+        int x = isXMajor ? i : j;
+        int y = isXMajor ? j : i;
+        pixels[y * width + x] = value;
+    }
+}
+
+static void drawWorldLine(const ObservationRenderer* r, uint8_t* pixels, Vec2 a, Vec2 b, uint8_t value)
+{
+    drawLine(pixels, r->width, r->height, worldToPixel(r, a), worldToPixel(r, b), value);
+}
+
+static void drawDisc(const ObservationRenderer* r, uint8_t* pixels, Vec2 center, float radius, uint8_t value)
+{
+    Vec2 c = worldToPixel(r, center);
+    // At least the pixel under the center, the ball is about a pixel wide at 84x84
+    float pr = fmaxf(radius * r->scale, 0.5f);
+    int x0 = std::max((int)floorf(c.x - pr), 0);
+    int x1 = std::min((int)ceilf(c.x + pr), r->width - 1);
+    int y0 = std::max((int)floorf(c.y - pr), 0);
+    int y1 = std::min((int)ceilf(c.y + pr), r->height - 1);
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            float ox = (float)x + 0.5f - c.x;
+            float oy = (float)y + 0.5f - c.y;
+            if (ox*ox + oy*oy <= pr*pr)
+            {
+                pixels[y * r->width + x] = value;
+            }
+        }
+    }
+}
+
+static void expandBounds(Vec2* minP, Vec2* maxP, Vec2 p)
+{
+    minP->x = fminf(minP->x, p.x);
+    minP->y = fminf(minP->y, p.y);
+    maxP->x = fmaxf(maxP->x, p.x);
+    maxP->y = fmaxf(maxP->y, p.y);
+}
+
+void initObservationRenderer(ObservationRenderer* r, const Table* table, int width, int height)
+{
+    r->width = width;
+    r->height = height;
+
+    // The static lines come from the same place as the GL renderer's. The lines of slingshots, ditch
+    // floors, pop bumpers and buttons are only highlighted at runtime, their initial state is static.
+    RenderData* rd = (RenderData*)malloc(sizeof(RenderData));
+    Hud hud;
+    initRenderData(rd, &hud, table);
+    Game* game = (Game*)malloc(sizeof(Game));
+    initGame(game, table, 0);
+    fillRenderData(rd, &hud, game);
+
+    struct WorldLine { Vec2 a, b; };
+    int numLines = rd->numStaticLineVerts / 2 + rd->numMirroredLineVerts / 2 + rd->numLineVerts / 2;
+    WorldLine* lines = (WorldLine*)malloc((size_t)numLines * sizeof(WorldLine));
+    WorldLine* ptr = lines;
+    for (int i = 0; i + 1 < rd->numStaticLineVerts; i += 2)
+    {
+        *ptr++ = { unpackVertexPos(rd->staticLineVerts[i]), unpackVertexPos(rd->staticLineVerts[i + 1]) };
+    }
+    for (int i = 0; i + 1 < rd->numMirroredLineVerts; i += 2)
+    {
+        *ptr++ = { reflect(unpackVertexPos(rd->staticLineVerts[i])), reflect(unpackVertexPos(rd->staticLineVerts[i + 1])) };
+    }
+    for (int i = 0; i + 1 < rd->numLineVerts; i += 2)
+    {
+        *ptr++ = { unpackVertexPos(rd->lineVerts[i]), unpackVertexPos(rd->lineVerts[i + 1]) };
+    }
+    assert(ptr - lines == numLines);
+
+    // Fit the table into the image
+    Vec2 minP = { 1e9f, 1e9f };
+    Vec2 maxP = { -1e9f, -1e9f };
+    for (int i = 0; i < numLines; ++i)
+    {
+        expandBounds(&minP, &maxP, lines[i].a);
+        expandBounds(&minP, &maxP, lines[i].b);
+    }
+    minP = minP - Vec2{ ballRadius, ballRadius };
+    maxP = maxP + Vec2{ ballRadius, ballRadius };
+    Vec2 size = maxP - minP;
+    r->scale = fminf((float)width / size.x, (float)height / size.y);
+    Vec2 margin = { ((float)width / r->scale - size.x) / 2.0f, ((float)height / r->scale - size.y) / 2.0f };
+    r->origin = { minP.x - margin.x, maxP.y + margin.y };
+
+    r->background = (uint8_t*)malloc((size_t)width * (size_t)height);
+    memset(r->background, 0, (size_t)width * (size_t)height);
+    for (int i = 0; i < numLines; ++i)
+    {
+        drawWorldLine(r, r->background, lines[i].a, lines[i].b, observationStaticValue);
+    }
+
+    DefaultVertex flipperVerts[numFlipperVerts];
+    makeFlipperVerts(flipperVerts);
+    for (int i = 0; i < numFlipperVerts; ++i)
+    {
+        r->flipperVerts[i] = unpackVertexPos(flipperVerts[i]);
+    }
+    DefaultVertex plungerVerts[numPlungerVerts];
+    makePlungerVerts(plungerVerts);
+    for (int i = 0; i < numPlungerVerts; ++i)
+    {
+        r->plungerVerts[i] = unpackVertexPos(plungerVerts[i]);
+    }
+
+    free(lines);
+    free(game);
+    freeRenderData(rd);
+    free(rd);
+}
+
+void freeObservationRenderer(ObservationRenderer* r)
+{
+    free(r->background);
+    r->background = nullptr;
+}
+
+void getObservationFeatures(const Game* games, int numGames, float* out)
+{
+    for (int i = 0; i < numGames; ++i)
+    {
+        const Game* game = &games[i];
+        float* f = out + i * numObservationFeatures;
+        f[obsBallX] = game->ball.p.x;
+        f[obsBallY] = game->ball.p.y;
+        f[obsBallVelocityX] = game->ball.v.x;
+        f[obsBallVelocityY] = game->ball.v.y;
+        f[obsLeftFlipperAngle] = game->flippers[0].orientation;
+        f[obsRightFlipperAngle] = game->flippers[1].orientation;
+        for (int j = 0; j < ditchesCap; ++j)
+        {
+            bool isClosed = j < game->table->numDitches && game->isDitchClosed[j];
+            f[obsDitchClosed0 + j] = isClosed ? 1.0f : 0.0f;
+        }
+        f[obsPlungerT] = game->plungerT;
+    }
+}
+
+void renderObservations(const ObservationRenderer* r, const Game* games, int numGames, uint8_t* out)
+{
+    constexpr uint8_t value = 255;
+    size_t imageSize = (size_t)r->width * (size_t)r->height;
+
+    for (int i = 0; i < numGames; ++i)
+    {
+        const Game* game = &games[i];
+        const Table* table = game->table;
+        uint8_t* pixels = out + (size_t)i * imageSize;
+
+        memcpy(pixels, r->background, imageSize);
+
+        for (int j = 0; j < numFlippers; ++j)
+        {
+            const Mat3& m = game->flippers[j].transform;
+            for (int k = 0; k < numFlipperVerts; ++k)
+            {
+                Vec2 a = r->flipperVerts[k];
+                Vec2 b = r->flipperVerts[(k + 1) % numFlipperVerts];
+                Vec3 wa = m * Vec3{ a.x, a.y, 1.0f };
+                Vec3 wb = m * Vec3{ b.x, b.y, 1.0f };
+                drawWorldLine(r, pixels, { wa.x, wa.y }, { wb.x, wb.y }, value);
+            }
+        }
+
+        float plungerScaleY = table->plungerTopY * (1.0f - game->plungerT);
+        for (int k = 0; k + 1 < numPlungerVerts; ++k)
+        {
+            Vec2 a = r->plungerVerts[k];
+            Vec2 b = r->plungerVerts[k + 1];
+            drawWorldLine(r, pixels,
+                { a.x + table->plungerCenterX, a.y * plungerScaleY },
+                { b.x + table->plungerCenterX, b.y * plungerScaleY }, value);
+        }
+
+        for (int j = 0; j < table->numDitches; ++j)
+        {
+            if (game->isDitchClosed[j])
+            {
+                drawWorldLine(r, pixels, table->ditches[j].lid.p0, table->ditches[j].lid.p1, value);
+            }
+        }
+
+        drawDisc(r, pixels, game->ball.p, ballRadius, value);
+    }
+}
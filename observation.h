@@ -0,0 +1,54 @@
+#pragma once
+
+#include "game.h"
+
+// Observations for training agents, written into caller buffers for a batch of games. Nothing is
+// allocated after initObservationRenderer().
+
+// Feature vector layout, floats in world units and radians
+enum ObservationFeature
+{
+    obsBallX,
+    obsBallY,
+    obsBallVelocityX,
+    obsBallVelocityY,
+    obsLeftFlipperAngle,
+    obsRightFlipperAngle,
+    // 1 when closed, 0 when open or the table has fewer ditches
+    obsDitchClosed0,
+    obsDitchClosed1,
+    obsPlungerT,
+    numObservationFeatures,
+};
+static_assert(obsDitchClosed1 - obsDitchClosed0 + 1 == ditchesCap, "One feature per ditch");
+
+constexpr int defaultObservationSize = 84;
+
+// Grayscale value of static geometry, moving parts are drawn at 255 over a black background
+constexpr uint8_t observationStaticValue = 128;
+
+// Grayscale raster of the table without the HUD, rows top to bottom
+struct ObservationRenderer
+{
+    int width;
+    int height;
+
+    // World to pixel transform, aspect preserving
+    Vec2 origin;
+    float scale;
+
+    // The static geometry, drawn once
+    uint8_t* background;
+
+    Vec2 flipperVerts[numFlipperVerts];
+    Vec2 plungerVerts[numPlungerVerts];
+};
+
+void initObservationRenderer(ObservationRenderer* r, const Table* table, int width, int height);
+void freeObservationRenderer(ObservationRenderer* r);
+
+// out holds numGames * numObservationFeatures floats
+void getObservationFeatures(const Game* games, int numGames, float* out);
+
+// out holds numGames * width * height bytes
+void renderObservations(const ObservationRenderer* r, const Game* games, int numGames, uint8_t* out);
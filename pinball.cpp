@@ -0,0 +1,189 @@
+#include "pinball.h"
+
+#include "game.h"
+#include "tablefile.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static_assert(sizeof(PinballState) == 44, "PinballState is part of the ABI");
+static_assert(numFlippers == 2 && ditchesCap == 2, "PinballState has room for 2 flippers and 2 ditches");
+
+struct PinballTable
+{
+    Table table;
+    // Snapshots from other tables are rejected
+    uint32_t hash;
+};
+
+struct PinballWorld
+{
+    Game game;
+};
+
+constexpr uint32_t snapshotMagic = 0x4e534250; // "PBSN"
+// Snapshots are the raw Game, so it goes up with every change to it. The size alone doesn't tell two
+// layouts apart.
+constexpr uint32_t snapshotVersion = 4;
+
+struct SnapshotHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t tableHash;
+};
+
+static uint32_t getTableHash(const Table* table)
+{
+    // The PinballTable owning the table
+    return ((const PinballTable*)table)->hash;
+}
+
+uint32_t pinballGetApiVersion(void)
+{
+    return PINBALL_API_VERSION;
+}
+
+PinballTable* pinballCreateDefaultTable(void)
+{
+    PinballTable* t = (PinballTable*)calloc(1, sizeof(PinballTable));
+    buildTable(&t->table);
+    t->hash = getTableChecksum(&t->table);
+    return t;
+}
+
+PinballTable* pinballLoadTable(const char* filename)
+{
+    PinballTable* t = (PinballTable*)calloc(1, sizeof(PinballTable));
+    if (!loadTable(&t->table, filename))
+    {
+        free(t);
+        return nullptr;
+    }
+    t->hash = getTableChecksum(&t->table);
+    return t;
+}
+
+void pinballDestroyTable(PinballTable* table)
+{
+    freeTable(&table->table);
+    free(table);
+}
+
+PinballWorld* pinballCreateWorld(const PinballTable* table)
+{
+    PinballWorld* world = (PinballWorld*)malloc(sizeof(PinballWorld));
+    initGame(&world->game, &table->table, 0);
+    return world;
+}
+
+void pinballResetWorld(PinballWorld* world, uint32_t seed)
+{
+    initGame(&world->game, world->game.table, seed);
+}
+
+void pinballDestroyWorld(PinballWorld* world)
+{
+    free(world);
+}
+
+void pinballStep(PinballWorld* world, uint32_t inputs, int32_t numTicks)
+{
+    GameInput input = {};
+    input.isLeftButtonDown = (inputs & PINBALL_INPUT_LEFT) != 0;
+    input.isRightButtonDown = (inputs & PINBALL_INPUT_RIGHT) != 0;
+    for (int32_t i = 0; i < numTicks; ++i)
+    {
+        updateGame(&world->game, input, simDt);
+    }
+}
+
+void pinballGetState(const PinballWorld* world, PinballState* state)
+{
+    const Game* game = &world->game;
+    *state = {};
+    state->ballX = game->ball.p.x;
+    state->ballY = game->ball.p.y;
+    state->ballVelocityX = game->ball.v.x;
+    state->ballVelocityY = game->ball.v.y;
+    for (int i = 0; i < numFlippers; ++i)
+    {
+        state->flipperAngles[i] = game->flippers[i].orientation;
+    }
+    state->plungerT = game->plungerT;
+    state->score = game->score;
+    state->highScore = game->highScore;
+    state->lives = game->lives;
+    for (int i = 0; i < ditchesCap; ++i)
+    {
+        state->isDitchClosed[i] = (i < game->table->numDitches && game->isDitchClosed[i]) ? 1 : 0;
+    }
+    state->isGameOver = game->isGameOver ? 1 : 0;
+}
+
+size_t pinballGetSnapshotSize(void)
+{
+    return sizeof(SnapshotHeader) + sizeof(Game);
+}
+
+void pinballSaveSnapshot(const PinballWorld* world, void* snapshot)
+{
+    SnapshotHeader header = {};
+    header.magic = snapshotMagic;
+    header.version = snapshotVersion;
+    header.size = (uint32_t)pinballGetSnapshotSize();
+    header.tableHash = getTableHash(world->game.table);
+
+    // The pointers mean nothing in another world or process
+    Game game = world->game;
+    game.table = nullptr;
+    game.tickCallback = nullptr;
+    game.tickCallbackUser = nullptr;
+
+    unsigned char* ptr = (unsigned char*)snapshot;
+    memcpy(ptr, &header, sizeof header);
+    memcpy(ptr + sizeof header, &game, sizeof game);
+}
+
+int32_t pinballRestoreSnapshot(PinballWorld* world, const void* snapshot)
+{
+    const unsigned char* ptr = (const unsigned char*)snapshot;
+    SnapshotHeader header;
+    memcpy(&header, ptr, sizeof header);
+    if (header.magic != snapshotMagic || header.version != snapshotVersion ||
+        header.size != pinballGetSnapshotSize() || header.tableHash != getTableHash(world->game.table))
+    {
+        return -1;
+    }
+
+    // The world keeps its pointers, and the snapshot's counts and indices could be anything
+    Game game;
+    memcpy(&game, ptr + sizeof header, sizeof game);
+    game.table = world->game.table;
+    game.tickCallback = world->game.tickCallback;
+    game.tickCallbackUser = world->game.tickCallbackUser;
+    if (!isGameValid(&game))
+    {
+        return -1;
+    }
+    world->game = game;
+    return 0;
+}
+
+void pinballStepBatch(PinballWorld* const* worlds, const uint32_t* inputs, int32_t numWorlds, int32_t numTicks)
+{
+    for (int32_t i = 0; i < numWorlds; ++i)
+    {
+        pinballStep(worlds[i], inputs[i], numTicks);
+    }
+}
+
+void pinballGetStateBatch(PinballWorld* const* worlds, int32_t numWorlds, PinballState* states)
+{
+    for (int32_t i = 0; i < numWorlds; ++i)
+    {
+        pinballGetState(worlds[i], &states[i]);
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * libpinball, the simulation behind a C ABI for embedding in other programs and languages.
+ *
+ * Handles are opaque, structs only ever grow at the end, and functions are only ever added, so a
+ * program built against an older header keeps working with a newer library.
+ * Worlds are independent of each other, a world must not be used from two threads at once.
+ */
+
+#ifndef PINBALL_H
+#define PINBALL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#  if defined(PINBALL_BUILD)
+#    define PINBALL_API __declspec(dllexport)
+#  else
+#    define PINBALL_API __declspec(dllimport)
+#  endif
+#else
+#  define PINBALL_API __attribute__((visibility("default")))
+#endif
+
+#define PINBALL_API_VERSION 3
+
+/* Bits of the inputs passed to pinballStep */
+#define PINBALL_INPUT_LEFT 1u
+#define PINBALL_INPUT_RIGHT 2u
+
+/* Length of a simulation tick in seconds */
+#define PINBALL_TICK_SECONDS (1.0f / 120.0f)
+
+typedef struct PinballTable PinballTable;
+typedef struct PinballWorld PinballWorld;
+
+typedef struct PinballState
+{
+    float ballX;
+    float ballY;
+    float ballVelocityX;
+    float ballVelocityY;
+    /* Radians, left then right */
+    float flipperAngles[2];
+    /* How far the plunger is pulled, 0 to 1 */
+    float plungerT;
+    int32_t score;
+    int32_t highScore;
+    int32_t lives;
+    uint8_t isDitchClosed[2];
+    uint8_t isGameOver;
+    uint8_t reserved;
+} PinballState;
+
+/* PINBALL_API_VERSION of the library, which may be newer than the header */
+PINBALL_API uint32_t pinballGetApiVersion(void);
+
+/* The table of the game. Tables are immutable and can be shared by any number of worlds. */
+PINBALL_API PinballTable* pinballCreateDefaultTable(void);
+/* A text or baked table file (see tablefile.h), NULL if it can't be loaded. Since version 3. */
+PINBALL_API PinballTable* pinballLoadTable(const char* filename);
+PINBALL_API void pinballDestroyTable(PinballTable* table);
+
+/* A game on the table, which must outlive the world. Worlds start with seed 0. */
+PINBALL_API PinballWorld* pinballCreateWorld(const PinballTable* table);
+PINBALL_API void pinballDestroyWorld(PinballWorld* world);
+
+/*
+ * Starts the game over with a seed for the bumpers and launches, the only random part of the game.
+ * Worlds with the same seed given the same inputs play out the same. Since version 2.
+ */
+PINBALL_API void pinballResetWorld(PinballWorld* world, uint32_t seed);
+
+/* Runs numTicks simulation ticks holding the inputs down. Pressing a button takes a tick with it up. */
+PINBALL_API void pinballStep(PinballWorld* world, uint32_t inputs, int32_t numTicks);
+PINBALL_API void pinballGetState(const PinballWorld* world, PinballState* state);
+
+/*
+ * Snapshots hold the whole state of a world in pinballGetSnapshotSize() bytes. They can be restored into
+ * any world on the same table, in this or another process running the same library.
+ * pinballRestoreSnapshot returns 0 on success and -1 if the snapshot is from another table or version, or damaged.
+ */
+PINBALL_API size_t pinballGetSnapshotSize(void);
+PINBALL_API void pinballSaveSnapshot(const PinballWorld* world, void* snapshot);
+PINBALL_API int32_t pinballRestoreSnapshot(PinballWorld* world, const void* snapshot);
+
+/* Batched versions, one call for many worlds. inputs and states have numWorlds elements. */
+PINBALL_API void pinballStepBatch(PinballWorld* const* worlds, const uint32_t* inputs, int32_t numWorlds, int32_t numTicks);
+PINBALL_API void pinballGetStateBatch(PinballWorld* const* worlds, int32_t numWorlds, PinballState* states);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <math.h>
+
+constexpr float pi{ 3.14159265f };
+constexpr float twoPi{ 2.0f * pi };
+
+struct Vec2
+{
+    float x;
+    float y;
+};
+
+struct Vec3
+{
+    float x;
+    float y;
+    float z;
+};
+
+struct Mat3
+{
+    float m[3][3];
+};
+
+inline Vec2 operator*(Vec2 v, float s)
+{
+    return {s*v.x, s*v.y};
+}
+
+inline Vec2 operator*(float s, Vec2 v)
+{
+    return {s*v.x, s*v.y};
+}
+
+inline Vec2 operator/(Vec2 v, float s)
+{
+    return {v.x/s, v.y/s};
+}
+
+inline Vec2 operator+(Vec2 a, Vec2 b)
+{
+    return {a.x+b.x, a.y+b.y};
+}
+
+inline Vec2 operator-(Vec2 a, Vec2 b)
+{
+    return {a.x-b.x, a.y-b.y};
+}
+
+inline float getLength(Vec2 v)
+{
+    return sqrtf(v.x*v.x + v.y*v.y);
+}
+
+inline Vec2 normalize(Vec2 v)
+{
+    return v/getLength(v);
+}
+
+inline Vec2 operator-(Vec2 v)
+{
+    return {-v.x, -v.y};
+}
+
+inline Vec2& operator+=(Vec2& a, Vec2 b)
+{
+    a.x += b.x;
+    a.y += b.y;
+    return a;
+}
+
+inline float dot(Vec2 a, Vec2 b)
+{
+    return a.x*b.x + a.y*b.y;
+}
+
+inline Vec2 perp(Vec2 v)
+{
+    return { -v.y, v.x };
+}
+
+inline float perpDot(Vec2 a, Vec2 b)
+{
+    return dot(perp(a), b);
+}
+
+inline float clamp(float x, float xMin, float xMax)
+{
+    float res;
+    if (x < xMin)
+    {
+        res = xMin;
+    }
+    else if (x > xMax)
+    {
+        res = xMax;
+    }
+    else
+    {
+        res = x;
+    }
+    return res;
+}
+
+inline float getDistance(Vec2 a, Vec2 b)
+{
+    return getLength(a - b);
+}
+
+constexpr Mat3 makeI3()
+{
+    Mat3 m{};
+    m.m[0][0] = 1.0f;
+    m.m[1][1] = 1.0f;
+    m.m[2][2] = 1.0f;
+    return m;
+}
+
+constexpr Mat3 I3{ makeI3() };
+
+inline Vec3 operator+(Vec3 a, Vec3 b)
+{
+    return { a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+inline Vec3 operator*(float t, Vec3 v)
+{
+    return { v.x * t, v.y * t, v.z * t };
+}
+
+inline bool operator==(Vec3 a, Vec3 b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+inline Vec3 operator*(const Mat3& m, Vec3 v)
+{
+    return {
+        m.m[0][0]*v.x + m.m[1][0]*v.y + m.m[2][0]*v.z,
+        m.m[0][1]*v.x + m.m[1][1]*v.y + m.m[2][1]*v.z,
+        m.m[0][2]*v.x + m.m[1][2]*v.y + m.m[2][2]*v.z,
+    };
+}
+
+struct Mat4
+{
+    float m[4][4];
+};
+
+inline Vec2 makeVec2(Vec3 v)
+{
+    return {v.x, v.y};
+}
+
+struct Mat2
+{
+    float m[2][2];
+};
+
+inline Mat2 makeRotationMat2(float angle)
+{
+    Mat2 m = {};
+    float c = cosf(angle);
+    float s = sinf(angle);
+    m.m[0][0] = c;  m.m[1][0] = -s;
+    m.m[0][1] = s;  m.m[1][1] = c;
+    return m;
+}
+
+inline Vec2 operator*(Mat2 m, Vec2 v)
+{
+    return {
+        m.m[0][0] * v.x + m.m[1][0] * v.y,
+        m.m[0][1] * v.x + m.m[1][1] * v.y,
+    };
+}
+
+inline Vec2 makeVec2FromAngle(float angle, float len = 1.0f)
+{
+    return { cosf(angle) * len, sinf(angle) * len };
+}
+
+// Reflect around Y axis
+inline Vec2 reflect(Vec2 v)
+{
+    return { -v.x, v.y };
+}
+
+inline float lerp(float x, float y, float t)
+{
+    return (1.0f - t) * x + t * y;
+}
+
+inline Vec3 lerp(Vec3 x, Vec3 y, float t)
+{
+    return (1.0f - t) * x + t * y;
+}
+
+inline float getAngle(Vec2 v)
+{
+    float a = atan2f(v.y, v.x);
+    if (fabsf(a) < 0.000001f)
+    {
+        a = 0.0f;
+    }
+    else if (a < 0)
+    {
+        a += twoPi;
+    }
+    return a;
+}
+
+// Reflect around Y axis
+inline float reflectAngle(float angle)
+{
+    return getAngle(reflect(makeVec2FromAngle(angle)));
+}
+
+constexpr float radians(float deg)
+{
+    return pi * deg / 180.0f;
+}
+
+inline Mat4 myOrtho(float l, float r, float b, float t, float n, float f)
+{
+    Mat4 m{};
+    m.m[0][0] = 2.0f/(r-l);
+    m.m[1][1] = 2.0f/(t-b);
+    m.m[2][2] = -2.0f/(f-n);
+    m.m[3][0] = -(r+l)/(r-l);
+    m.m[3][1] = -(t+b)/(t-b);
+    m.m[3][2] = -(f+n)/(f-n);
+    m.m[3][3] = 1.0f;
+    return m;
+}
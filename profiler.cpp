@@ -0,0 +1,227 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <stdio.h>
+
+void initProfiler(Profiler* profiler)
+{
+    *profiler = {};
+    // The first beginProfileFrame() moves to slot 0
+    profiler->frameIndex = profileFramesCap - 1;
+}
+
+void beginProfileFrame(Profiler* profiler)
+{
+    profiler->frameIndex = (profiler->frameIndex + 1) % profileFramesCap;
+    for (int phase = 0; phase < numProfilePhases; ++phase)
+    {
+        profiler->phaseTimes[phase][profiler->frameIndex] = 0.0f;
+    }
+    profiler->numSteps[profiler->frameIndex] = 0;
+    profiler->hasGpuTimes[profiler->frameIndex] = false;
+    if (profiler->numFrames < profileFramesCap)
+    {
+        ++profiler->numFrames;
+    }
+}
+
+void addProfileTime(Profiler* profiler, ProfilePhase phase, double seconds)
+{
+    profiler->phaseTimes[phase][profiler->frameIndex] += (float)seconds;
+}
+
+void setProfileSteps(Profiler* profiler, int numSteps)
+{
+    profiler->numSteps[profiler->frameIndex] = numSteps;
+}
+
+void setProfileGpuTimes(Profiler* profiler, const double* seconds, int numTimes)
+{
+    assert(numTimes == numGpuProfilePhases);
+    for (int i = 0; i < numTimes; ++i)
+    {
+        profiler->phaseTimes[firstGpuProfilePhase + i][profiler->frameIndex] = (float)seconds[i];
+    }
+    profiler->hasGpuTimes[profiler->frameIndex] = true;
+}
+
+// Sorts the samples
+static ProfileStats getProfileStats(float* samples, int numSamples)
+{
+    ProfileStats stats = {};
+    if (numSamples == 0)
+    {
+        return stats;
+    }
+    std::sort(samples, samples + numSamples);
+    double sum = 0.0;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        sum += samples[i];
+    }
+    // Nearest rank
+    int p99Index = (99 * numSamples + 99) / 100 - 1;
+    stats.min = samples[0] * 1000.0f;
+    stats.avg = (float)(sum / numSamples * 1000.0);
+    stats.p99 = samples[p99Index] * 1000.0f;
+    return stats;
+}
+
+void updateProfileStats(Profiler* profiler)
+{
+    // The frame in progress isn't counted, it hasn't run all of its phases yet
+    int numFrames = std::max(profiler->numFrames - 1, 0);
+    float samples[profileFramesCap];
+
+    for (int phase = 0; phase < numProfilePhases; ++phase)
+    {
+        bool isGpuPhase = phase >= firstGpuProfilePhase;
+        int numSamples = 0;
+        for (int i = 0; i < numFrames; ++i)
+        {
+            int frameIndex = (profiler->frameIndex - 1 - i + profileFramesCap) % profileFramesCap;
+            if (!isGpuPhase || profiler->hasGpuTimes[frameIndex])
+            {
+                samples[numSamples++] = profiler->phaseTimes[phase][frameIndex];
+            }
+        }
+        profiler->phaseStats[phase] = getProfileStats(samples, numSamples);
+    }
+
+    int numStepSamples = 0;
+    for (int i = 0; i < numFrames; ++i)
+    {
+        int frameIndex = (profiler->frameIndex - 1 - i + profileFramesCap) % profileFramesCap;
+        int numSteps = profiler->numSteps[frameIndex];
+        if (numSteps > 0)
+        {
+            samples[numStepSamples++] = profiler->phaseTimes[profilePhysics][frameIndex] / (float)numSteps;
+        }
+    }
+    profiler->stepStats = getProfileStats(samples, numStepSamples);
+}
+
+double getProfileSeconds()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+const char* getProfilePhaseName(ProfilePhase phase)
+{
+    static const char* const names[numProfilePhases] = {
+        "input", "physics", "vertices", "text layout", "submit", "swap",
+        "gpu circles", "gpu flippers", "gpu lines", "gpu ditch lids", "gpu plunger", "gpu debug", "gpu text",
+    };
+    return names[phase];
+}
+
+//
+// Overlay
+//
+
+// Under the HUD, rows of 13 glyphs fit on the screen
+constexpr int overlayX = 580;
+constexpr int overlayTopY = 470;
+constexpr int overlayRowHeight = 30;
+constexpr float overlayBarWidth = 200.0f;
+constexpr float overlayBudgetMs = 1000.0f / 60.0f;
+
+static const char* const cpuRowNames[numProfileRows] = { "IN", "PHY", "VTX", "TXT", "GL", "SWP", "STP" };
+static const char* const gpuRowNames[numGpuProfilePhases] = { "CIR", "FLP", "LIN", "LID", "PLG", "DBG", "TXT" };
+
+static int getRowY(int row)
+{
+    return overlayTopY - (row + 1) * overlayRowHeight;
+}
+
+// Pixels of the HUD to world units, undoing the view and the projection of the main shader
+static Vec2 screenToWorld(float x, float y)
+{
+    constexpr float viewX = -10.0f;
+    return {
+        x / (float)scrWidth * Constants::worldSize + Constants::worldL - viewX,
+        y / (float)scrHeight * Constants::worldSize,
+    };
+}
+
+static DefaultVertex* addScreenLine(DefaultVertex* ptr, float x0, float y0, float x1, float y1, Vec3 color)
+{
+    *ptr++ = makeVertex(screenToWorld(x0, y0), color);
+    *ptr++ = makeVertex(screenToWorld(x1, y1), color);
+    return ptr;
+}
+
+static float getBarX(float ms)
+{
+    return (float)overlayX + std::min(ms / overlayBudgetMs, 1.0f) * overlayBarWidth;
+}
+
+void initProfileOverlay(ProfileOverlay* overlay, RenderData* rd)
+{
+    *overlay = {};
+    overlay->headerText = addTextRun(rd, overlayX, overlayTopY, "", auxCol);
+    for (int row = 0; row < numProfileRows; ++row)
+    {
+        overlay->rowTexts[row] = addTextRun(rd, overlayX, getRowY(row), "", auxCol);
+    }
+}
+
+void fillProfileOverlay(const Profiler* profiler, const ProfileOverlay* overlay, RenderData* rd)
+{
+    if (overlay->mode == profileOverlayHidden)
+    {
+        setText(rd, overlay->headerText, "", auxCol);
+        for (int row = 0; row < numProfileRows; ++row)
+        {
+            setText(rd, overlay->rowTexts[row], "", auxCol);
+        }
+        return;
+    }
+
+    bool isGpu = overlay->mode == profileOverlayGpu;
+    int numRows = isGpu ? numGpuProfilePhases : numProfileRows;
+    setText(rd, overlay->headerText, isGpu ? "GPU  AVG  P99" : "CPU  AVG  P99", auxCol);
+
+    DefaultVertex* ptr = rd->debugVerts + rd->numDebugVerts;
+    constexpr int vertsPerRow = 12;
+    assert(rd->numDebugVerts + numProfileRows * vertsPerRow <= debugVertsCap);
+
+    for (int row = 0; row < numProfileRows; ++row)
+    {
+        if (row >= numRows)
+        {
+            setText(rd, overlay->rowTexts[row], "", auxCol);
+            continue;
+        }
+
+        const ProfileStats& stats = isGpu ? profiler->phaseStats[firstGpuProfilePhase + row] :
+            (row < firstGpuProfilePhase) ? profiler->phaseStats[row] : profiler->stepStats;
+
+        // Wider values would overflow the text run, the p99 tick shows finer than a tenth
+        char str[textRunCap];
+        snprintf(str, sizeof str, "%-3s%5.2f%5.1f", isGpu ? gpuRowNames[row] : cpuRowNames[row],
+            (double)std::min(stats.avg, 99.99f), (double)std::min(stats.p99, 99.9f));
+        setText(rd, overlay->rowTexts[row], str, auxCol);
+
+        float y = (float)getRowY(row);
+        float avgX = getBarX(stats.avg);
+        for (int i = 0; i < 3; ++i)
+        {
+            float lineY = y - 6.0f - 2.0f * (float)i;
+            ptr = addScreenLine(ptr, (float)overlayX, lineY, avgX, lineY, defCol);
+        }
+        float minX = getBarX(stats.min);
+        float p99X = getBarX(stats.p99);
+        ptr = addScreenLine(ptr, minX, y - 4.0f, minX, y - 12.0f, auxCol);
+        ptr = addScreenLine(ptr, p99X, y - 4.0f, p99X, y - 12.0f, highlightCol);
+
+        // The end of the budget
+        float budgetX = (float)overlayX + overlayBarWidth;
+        ptr = addScreenLine(ptr, budgetX, y - 4.0f, budgetX, y - 12.0f, auxCol);
+    }
+
+    rd->numDebugVerts = (int)(ptr - rd->debugVerts);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "game.h"
+#include "trace.h"
+
+// Times the phases of each frame of the game loop and keeps the last few seconds of them, so the
+// rolling min, average and 99th percentile of every phase can be drawn over the game (see
+// fillProfileOverlay()). The physics phase is all the fixed steps a frame ran, their number is kept
+// too so the cost of a single step shows. The GPU phases are the draw groups of the renderer's timer
+// queries, they come in a couple of frames late and not for every frame.
+
+enum ProfilePhase
+{
+    profileInput,
+    profilePhysics,
+    profileVertices,
+    profileText,
+    profileSubmit,
+    profileSwap,
+
+    // In the order of GpuTimerGroup (renderer.h)
+    profileGpuCircles,
+    profileGpuFlippers,
+    profileGpuLines,
+    profileGpuDitchLids,
+    profileGpuPlunger,
+    profileGpuDebug,
+    profileGpuText,
+
+    numProfilePhases,
+};
+
+constexpr int firstGpuProfilePhase = profileGpuCircles;
+constexpr int numGpuProfilePhases = numProfilePhases - firstGpuProfilePhase;
+
+// About two seconds at 60 frames per second
+constexpr int profileFramesCap = 128;
+
+// In milliseconds
+struct ProfileStats
+{
+    float min;
+    float avg;
+    float p99;
+};
+
+struct Profiler
+{
+    // Ring of the last profileFramesCap frames, in seconds
+    float phaseTimes[numProfilePhases][profileFramesCap];
+    int numSteps[profileFramesCap];
+    bool hasGpuTimes[profileFramesCap];
+    int frameIndex;
+    int numFrames;
+
+    // Of the frames in the ring, updated by updateProfileStats(). The GPU phases only count the frames
+    // that got GPU times.
+    ProfileStats phaseStats[numProfilePhases];
+    // Physics time of a single fixed step, of the frames that ran any
+    ProfileStats stepStats;
+};
+
+void initProfiler(Profiler* profiler);
+// Moves to the next slot of the ring, times added before the next call go to this frame
+void beginProfileFrame(Profiler* profiler);
+void addProfileTime(Profiler* profiler, ProfilePhase phase, double seconds);
+void setProfileSteps(Profiler* profiler, int numSteps);
+// Seconds of every GPU phase, in their order
+void setProfileGpuTimes(Profiler* profiler, const double* seconds, int numTimes);
+// Sorts a copy of the ring for the percentiles, a few times a second is plenty
+void updateProfileStats(Profiler* profiler);
+
+// Monotonic, in seconds
+double getProfileSeconds();
+// A string literal, for the trace
+const char* getProfilePhaseName(ProfilePhase phase);
+
+// Adds the time until the end of the scope to a phase of the current frame, and traces it
+struct ProfileScope
+{
+    Profiler* profiler;
+    ProfilePhase phase;
+    double start;
+
+    ProfileScope(Profiler* profiler, ProfilePhase phase)
+        : profiler(profiler), phase(phase), start(getProfileSeconds())
+    {
+        beginTraceEvent(getProfilePhaseName(phase));
+    }
+
+    ~ProfileScope()
+    {
+        endTraceEvent();
+        addProfileTime(profiler, phase, getProfileSeconds() - start);
+    }
+};
+
+// The CPU phases and a row for the single physics step, or the GPU phases
+constexpr int numProfileRows = firstGpuProfilePhase + 1;
+static_assert(numGpuProfilePhases <= numProfileRows, "The GPU phases don't fit in the overlay");
+
+enum ProfileOverlayMode
+{
+    profileOverlayHidden,
+    profileOverlayCpu,
+    profileOverlayGpu,
+    numProfileOverlayModes,
+};
+
+// A bar per row under the HUD, the full width is the 60 Hz frame budget. The bar is the average,
+// the ticks the min and the 99th percentile.
+struct ProfileOverlay
+{
+    TextRun* headerText;
+    TextRun* rowTexts[numProfileRows];
+    ProfileOverlayMode mode;
+};
+
+void initProfileOverlay(ProfileOverlay* overlay, RenderData* rd);
+// After fillRenderData(), the bars are added to the debug lines
+void fillProfileOverlay(const Profiler* profiler, const ProfileOverlay* overlay, RenderData* rd);
@@ -0,0 +1,715 @@
+#include "recorder.h"
+#include "trace.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+static void reserveBytes(ByteBuffer* b, size_t size)
+{
+    if (b->cap < size)
+    {
+        b->cap = std::max(size, b->cap * 2);
+        b->data = (unsigned char*)realloc(b->data, b->cap);
+    }
+}
+
+static void appendByte(ByteBuffer* b, unsigned char value)
+{
+    reserveBytes(b, b->size + 1);
+    b->data[b->size++] = value;
+}
+
+static void appendBytes(ByteBuffer* b, const void* data, size_t size)
+{
+    reserveBytes(b, b->size + size);
+    memcpy(b->data + b->size, data, size);
+    b->size += size;
+}
+
+static void appendU16(ByteBuffer* b, int value)
+{
+    appendByte(b, (unsigned char)(value & 0xff));
+    appendByte(b, (unsigned char)((value >> 8) & 0xff));
+}
+
+//
+// GIF
+//
+
+constexpr int gifPaletteSize = 256;
+constexpr int gifColorBins = 1 << 15;
+
+static int getColorBin(const unsigned char* rgba)
+{
+    return ((rgba[0] >> 3) << 10) | ((rgba[1] >> 3) << 5) | (rgba[2] >> 3);
+}
+
+static unsigned char expand5(int value)
+{
+    return (unsigned char)((value << 3) | (value >> 2));
+}
+
+// Picks the most frequent colors (at 5 bits per channel), every other color maps to the nearest one.
+// The table is line art on a flat background, so there are rarely more than a handful of colors.
+static void quantize(const unsigned char* pixels, int numPixels, unsigned char* palette, uint8_t* binToIndex)
+{
+    static thread_local uint32_t counts[gifColorBins];
+    memset(counts, 0, sizeof counts);
+    for (int i = 0; i < numPixels; ++i)
+    {
+        ++counts[getColorBin(pixels + i * 4)];
+    }
+
+    static thread_local uint16_t usedBins[gifColorBins];
+    int numUsedBins = 0;
+    for (int bin = 0; bin < gifColorBins; ++bin)
+    {
+        if (counts[bin])
+        {
+            usedBins[numUsedBins++] = (uint16_t)bin;
+        }
+    }
+
+    int numColors = std::min(numUsedBins, gifPaletteSize);
+    std::partial_sort(usedBins, usedBins + numColors, usedBins + numUsedBins,
+        [](uint16_t a, uint16_t b) { return counts[a] > counts[b]; });
+
+    memset(palette, 0, gifPaletteSize * 3);
+    for (int i = 0; i < numColors; ++i)
+    {
+        int bin = usedBins[i];
+        palette[i * 3 + 0] = expand5(bin >> 10);
+        palette[i * 3 + 1] = expand5((bin >> 5) & 31);
+        palette[i * 3 + 2] = expand5(bin & 31);
+        binToIndex[bin] = (uint8_t)i;
+    }
+
+    for (int i = numColors; i < numUsedBins; ++i)
+    {
+        int bin = usedBins[i];
+        int r = bin >> 10;
+        int g = (bin >> 5) & 31;
+        int b = bin & 31;
+
+        int bestIndex = 0;
+        int bestDistance = 1 << 30;
+        for (int j = 0; j < numColors; ++j)
+        {
+            int palBin = usedBins[j];
+            int dr = r - (palBin >> 10);
+            int dg = g - ((palBin >> 5) & 31);
+            int db = b - (palBin & 31);
+            int distance = dr*dr + dg*dg + db*db;
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                bestIndex = j;
+            }
+        }
+        binToIndex[bin] = (uint8_t)bestIndex;
+    }
+}
+
+// Packs variable length codes LSB first into 255 byte sub-blocks
+struct GifBitWriter
+{
+    ByteBuffer* out;
+    uint32_t bits;
+    int numBits;
+    unsigned char block[255];
+    int blockSize;
+};
+
+static void putGifByte(GifBitWriter* w, unsigned char value)
+{
+    w->block[w->blockSize++] = value;
+    if (w->blockSize == 255)
+    {
+        appendByte(w->out, 255);
+        appendBytes(w->out, w->block, 255);
+        w->blockSize = 0;
+    }
+}
+
+static void putGifCode(GifBitWriter* w, int code, int codeSize)
+{
+    w->bits |= (uint32_t)code << w->numBits;
+    w->numBits += codeSize;
+    while (w->numBits >= 8)
+    {
+        putGifByte(w, (unsigned char)(w->bits & 0xff));
+        w->bits >>= 8;
+        w->numBits -= 8;
+    }
+}
+
+static void finishGifCodes(GifBitWriter* w)
+{
+    if (w->numBits > 0)
+    {
+        putGifByte(w, (unsigned char)(w->bits & 0xff));
+    }
+    if (w->blockSize > 0)
+    {
+        appendByte(w->out, (unsigned char)w->blockSize);
+        appendBytes(w->out, w->block, (size_t)w->blockSize);
+    }
+    appendByte(w->out, 0);
+}
+
+constexpr int lzwMinCodeSize = 8;
+constexpr int lzwMaxCode = 4095;
+constexpr int lzwHashBits = 13;
+constexpr int lzwHashSize = 1 << lzwHashBits;
+
+// (prefix code, next index) -> code, open addressing
+struct LzwTable
+{
+    int32_t keys[lzwHashSize];
+    uint16_t codes[lzwHashSize];
+};
+
+static int getLzwSlot(const LzwTable* t, int32_t key)
+{
+    uint32_t slot = ((uint32_t)key * 2654435761u) >> (32 - lzwHashBits);
+    while (t->keys[slot] != -1 && t->keys[slot] != key)
+    {
+        slot = (slot + 1) & (lzwHashSize - 1);
+    }
+    return (int)slot;
+}
+
+static void encodeLzw(ByteBuffer* out, const uint8_t* indices, int numIndices)
+{
+    static thread_local LzwTable table;
+    memset(table.keys, 0xff, sizeof table.keys);
+
+    const int clearCode = 1 << lzwMinCodeSize;
+    const int endCode = clearCode + 1;
+    int codeSize = lzwMinCodeSize + 1;
+    int maxCode = endCode;
+
+    GifBitWriter w = {};
+    w.out = out;
+
+    appendByte(out, lzwMinCodeSize);
+    putGifCode(&w, clearCode, codeSize);
+
+    int prefix = indices[0];
+    for (int i = 1; i < numIndices; ++i)
+    {
+        int32_t key = (prefix << 8) | indices[i];
+        int slot = getLzwSlot(&table, key);
+        if (table.keys[slot] == key)
+        {
+            prefix = table.codes[slot];
+            continue;
+        }
+
+        putGifCode(&w, prefix, codeSize);
+
+        ++maxCode;
+        table.keys[slot] = key;
+        table.codes[slot] = (uint16_t)maxCode;
+        if (maxCode >= (1 << codeSize))
+        {
+            ++codeSize;
+        }
+        if (maxCode == lzwMaxCode)
+        {
+            putGifCode(&w, clearCode, codeSize);
+            memset(table.keys, 0xff, sizeof table.keys);
+            codeSize = lzwMinCodeSize + 1;
+            maxCode = endCode;
+        }
+
+        prefix = indices[i];
+    }
+
+    putGifCode(&w, prefix, codeSize);
+
+    // The decoder adds an entry for the last code too, which can widen the end code
+    ++maxCode;
+    if (maxCode >= (1 << codeSize))
+    {
+        ++codeSize;
+    }
+    putGifCode(&w, endCode, codeSize);
+    finishGifCodes(&w);
+}
+
+// Everything after the graphic control extension, which needs the delay of the frame
+static void encodeGifFrame(ByteBuffer* out, const unsigned char* pixels, int width, int height)
+{
+    int numPixels = width * height;
+
+    unsigned char palette[gifPaletteSize * 3];
+    static thread_local uint8_t binToIndex[gifColorBins];
+    quantize(pixels, numPixels, palette, binToIndex);
+
+    // Also flips the rows, GIF goes top to bottom
+    uint8_t* indices = (uint8_t*)malloc((size_t)numPixels);
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* src = pixels + (size_t)(height - 1 - y) * (size_t)width * 4;
+        uint8_t* dst = indices + (size_t)y * (size_t)width;
+        for (int x = 0; x < width; ++x)
+        {
+            dst[x] = binToIndex[getColorBin(src + x * 4)];
+        }
+    }
+
+    // Image descriptor with a local color table
+    appendByte(out, 0x2c);
+    appendU16(out, 0);
+    appendU16(out, 0);
+    appendU16(out, width);
+    appendU16(out, height);
+    appendByte(out, 0x80 | 7);
+    appendBytes(out, palette, sizeof palette);
+
+    encodeLzw(out, indices, numPixels);
+
+    free(indices);
+}
+
+static int getGifTime(const Recorder* r, int frameIndex)
+{
+    return (int)lroundf((float)frameIndex * 100.0f / r->fps);
+}
+
+//
+// Y4M
+//
+
+// Full range BT.601 (C420jpeg), chroma is averaged over 2x2 pixels
+static void encodeY4mFrame(ByteBuffer* out, const unsigned char* pixels, int width, int height)
+{
+    static const char frameHeader[] = "FRAME\n";
+    appendBytes(out, frameHeader, sizeof frameHeader - 1);
+
+    size_t lumaSize = (size_t)width * (size_t)height;
+    size_t chromaSize = lumaSize / 4;
+    size_t start = out->size;
+    reserveBytes(out, start + lumaSize + 2 * chromaSize);
+    out->size = start + lumaSize + 2 * chromaSize;
+
+    unsigned char* yPlane = out->data + start;
+    unsigned char* uPlane = yPlane + lumaSize;
+    unsigned char* vPlane = uPlane + chromaSize;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* src = pixels + (size_t)(height - 1 - y) * (size_t)width * 4;
+        unsigned char* dst = yPlane + (size_t)y * (size_t)width;
+        for (int x = 0; x < width; ++x)
+        {
+            int r = src[x * 4 + 0];
+            int g = src[x * 4 + 1];
+            int b = src[x * 4 + 2];
+            dst[x] = (unsigned char)((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+        }
+    }
+
+    int chromaWidth = width / 2;
+    for (int y = 0; y < height / 2; ++y)
+    {
+        const unsigned char* row0 = pixels + (size_t)(height - 1 - 2 * y) * (size_t)width * 4;
+        const unsigned char* row1 = row0 - (size_t)width * 4;
+        for (int x = 0; x < chromaWidth; ++x)
+        {
+            const unsigned char* p0 = row0 + x * 8;
+            const unsigned char* p1 = row1 + x * 8;
+            int r = p0[0] + p0[4] + p1[0] + p1[4];
+            int g = p0[1] + p0[5] + p1[1] + p1[5];
+            int b = p0[2] + p0[6] + p1[2] + p1[6];
+            // Sums of 4 pixels, hence the extra >> 2
+            int u = (-11059 * r - 21709 * g + 32768 * b + (128 << 18) + (1 << 17)) >> 18;
+            int v = (32768 * r - 27439 * g - 5329 * b + (128 << 18) + (1 << 17)) >> 18;
+            uPlane[y * chromaWidth + x] = (unsigned char)std::min(std::max(u, 0), 255);
+            vPlane[y * chromaWidth + x] = (unsigned char)std::min(std::max(v, 0), 255);
+        }
+    }
+}
+
+//
+// Workers
+//
+
+static RecordJob* getJob(Recorder* r, int sequence)
+{
+    return &r->jobs[sequence % r->numJobs];
+}
+
+static bool canWriteNextJob(Recorder* r)
+{
+    if (r->isWriting || r->nextToWrite == r->nextSequence || getJob(r, r->nextToWrite)->state != RecordJobState::Encoded)
+    {
+        return false;
+    }
+    // A GIF frame's delay is only known once the next frame arrives
+    return r->format != RecordingFormat::Gif || r->nextToWrite + 1 < r->nextSequence || r->isStopping;
+}
+
+static void writeJob(Recorder* r, const RecordJob* job, int nextFrameIndex)
+{
+    if (r->format == RecordingFormat::Gif)
+    {
+        int delay = (nextFrameIndex >= 0) ?
+            getGifTime(r, nextFrameIndex) - getGifTime(r, job->frameIndex) :
+            (int)lroundf(100.0f / r->fps);
+        delay = std::max(delay, 2);
+
+        // Graphic control extension: no disposal, no transparency
+        unsigned char gce[] = { 0x21, 0xf9, 4, 0x04, (unsigned char)(delay & 0xff), (unsigned char)(delay >> 8), 0, 0 };
+        fwrite(gce, sizeof gce, 1, r->file);
+    }
+    fwrite(job->encoded.data, 1, job->encoded.size, r->file);
+}
+
+static void recorderWorker(Recorder* r)
+{
+    setTraceThreadName("recorder");
+    std::unique_lock<std::mutex> lock(r->mutex);
+    for (;;)
+    {
+        if (canWriteNextJob(r))
+        {
+            RecordJob* job = getJob(r, r->nextToWrite);
+            int nextFrameIndex = (r->nextToWrite + 1 < r->nextSequence) ? getJob(r, r->nextToWrite + 1)->frameIndex : -1;
+            r->isWriting = true;
+
+            lock.unlock();
+            beginTraceEvent("write");
+            writeJob(r, job, nextFrameIndex);
+            endTraceEvent();
+            lock.lock();
+
+            job->state = RecordJobState::Free;
+            ++r->nextToWrite;
+            r->isWriting = false;
+            r->cond.notify_all();
+            continue;
+        }
+
+        if (r->nextToEncode < r->nextSequence && getJob(r, r->nextToEncode)->state == RecordJobState::Queued)
+        {
+            RecordJob* job = getJob(r, r->nextToEncode++);
+            job->state = RecordJobState::Encoding;
+
+            lock.unlock();
+            beginTraceEvent("encode");
+            job->encoded.size = 0;
+            if (r->format == RecordingFormat::Gif)
+            {
+                encodeGifFrame(&job->encoded, job->pixels, r->width, r->height);
+            }
+            else
+            {
+                encodeY4mFrame(&job->encoded, job->pixels, r->width, r->height);
+            }
+            endTraceEvent();
+            lock.lock();
+
+            job->state = RecordJobState::Encoded;
+            r->cond.notify_all();
+            continue;
+        }
+
+        if (r->isStopping && r->nextToWrite == r->nextSequence)
+        {
+            return;
+        }
+
+        r->cond.wait(lock);
+    }
+}
+
+static bool hasExtension(const char* filename, const char* extension)
+{
+    size_t len = strlen(filename);
+    size_t extLen = strlen(extension);
+    return len >= extLen && strcmp(filename + len - extLen, extension) == 0;
+}
+
+bool initRecorder(Recorder* r, const char* filename, int width, int height, float fps)
+{
+    if (hasExtension(filename, ".gif"))
+    {
+        r->format = RecordingFormat::Gif;
+    }
+    else if (hasExtension(filename, ".y4m"))
+    {
+        r->format = RecordingFormat::Y4m;
+        if (width % 2 || height % 2)
+        {
+            fprintf(stderr, "Y4M recording needs an even frame size\n");
+            return false;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Unknown recording format %s, expected .gif or .y4m\n", filename);
+        return false;
+    }
+
+    r->file = fopen(filename, "wb");
+    if (!r->file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+
+    r->width = width;
+    r->height = height;
+    r->fps = fps;
+
+    if (r->format == RecordingFormat::Gif)
+    {
+        ByteBuffer header = {};
+        appendBytes(&header, "GIF89a", 6);
+        // Logical screen descriptor without a global color table
+        appendU16(&header, width);
+        appendU16(&header, height);
+        appendByte(&header, 0);
+        appendByte(&header, 0);
+        appendByte(&header, 0);
+        // Loop forever
+        static const unsigned char netscape[] = { 0x21, 0xff, 11, 'N','E','T','S','C','A','P','E','2','.','0', 3, 1, 0, 0, 0 };
+        appendBytes(&header, netscape, sizeof netscape);
+        fwrite(header.data, 1, header.size, r->file);
+        free(header.data);
+    }
+    else
+    {
+        fprintf(r->file, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420jpeg\n", width, height, (int)lroundf(fps * 1000.0f));
+    }
+
+    unsigned int numCores = std::thread::hardware_concurrency();
+    r->numWorkers = std::min(std::max((int)numCores - 1, 1), recorderWorkersCap);
+    r->numJobs = 2 * r->numWorkers + 2;
+
+    for (int i = 0; i < r->numJobs; ++i)
+    {
+        RecordJob* job = &r->jobs[i];
+        job->state = RecordJobState::Free;
+        job->pixels = (unsigned char*)malloc((size_t)width * (size_t)height * 4);
+        job->encoded = {};
+    }
+    r->nextSequence = 0;
+    r->nextToEncode = 0;
+    r->nextToWrite = 0;
+    r->isWriting = false;
+    r->isStopping = false;
+    r->lastGifTime = -1000;
+    r->numFrames = 0;
+
+    for (int i = 0; i < r->numWorkers; ++i)
+    {
+        r->workers[i] = std::thread(recorderWorker, r);
+    }
+
+    return true;
+}
+
+void recordFrame(Recorder* r, const unsigned char* pixels, int frameIndex)
+{
+    if (r->format == RecordingFormat::Gif)
+    {
+        int time = getGifTime(r, frameIndex);
+        if (time - r->lastGifTime < 2)
+        {
+            return;
+        }
+        r->lastGifTime = time;
+    }
+
+    RecordJob* job;
+    {
+        std::unique_lock<std::mutex> lock(r->mutex);
+        job = getJob(r, r->nextSequence);
+        r->cond.wait(lock, [job] { return job->state == RecordJobState::Free; });
+        job->state = RecordJobState::Filling;
+    }
+
+    memcpy(job->pixels, pixels, (size_t)r->width * (size_t)r->height * 4);
+
+    {
+        std::lock_guard<std::mutex> lock(r->mutex);
+        job->frameIndex = frameIndex;
+        job->state = RecordJobState::Queued;
+        ++r->nextSequence;
+    }
+    r->cond.notify_all();
+
+    ++r->numFrames;
+}
+
+void finishRecorder(Recorder* r)
+{
+    {
+        std::lock_guard<std::mutex> lock(r->mutex);
+        r->isStopping = true;
+    }
+    r->cond.notify_all();
+    for (int i = 0; i < r->numWorkers; ++i)
+    {
+        r->workers[i].join();
+    }
+
+    if (r->format == RecordingFormat::Gif)
+    {
+        fputc(0x3b, r->file);
+    }
+    fclose(r->file);
+    r->file = nullptr;
+
+    for (int i = 0; i < r->numJobs; ++i)
+    {
+        assert(r->jobs[i].state == RecordJobState::Free);
+        free(r->jobs[i].pixels);
+        free(r->jobs[i].encoded.data);
+    }
+}
+
+bool writePpm(const char* filename, const unsigned char* rgba, int width, int height)
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+    // OpenGL rows go bottom to top
+    unsigned char* row = (unsigned char*)malloc((size_t)width * 3);
+    for (int y = height - 1; y >= 0; --y)
+    {
+        const unsigned char* src = rgba + (size_t)y * (size_t)width * 4;
+        for (int x = 0; x < width; ++x)
+        {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        fwrite(row, 3, (size_t)width, file);
+    }
+    free(row);
+
+    fclose(file);
+    return true;
+}
+
+static void appendU32BigEndian(ByteBuffer* b, uint32_t value)
+{
+    unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value };
+    appendBytes(b, bytes, sizeof bytes);
+}
+
+static uint32_t getCrc32(const unsigned char* data, size_t size)
+{
+    // Made every time, it's cheap next to the image and keeps it safe to call from any thread
+    uint32_t table[256];
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+        {
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+// Length, type, data and the CRC of the type and data
+static void appendPngChunk(ByteBuffer* out, const char* type, const ByteBuffer* data)
+{
+    appendU32BigEndian(out, (uint32_t)data->size);
+    size_t typeStart = out->size;
+    appendBytes(out, type, 4);
+    if (data->size > 0)
+    {
+        appendBytes(out, data->data, data->size);
+    }
+    appendU32BigEndian(out, getCrc32(out->data + typeStart, out->size - typeStart));
+}
+
+bool writePng(const char* filename, const unsigned char* rgba, int width, int height)
+{
+    // RGBA rows top to bottom, each after a filter byte of 0
+    size_t rowSize = (size_t)width * 4 + 1;
+    ByteBuffer raw = {};
+    reserveBytes(&raw, rowSize * (size_t)height);
+    for (int y = height - 1; y >= 0; --y)
+    {
+        appendByte(&raw, 0);
+        appendBytes(&raw, rgba + (size_t)y * (size_t)width * 4, (size_t)width * 4);
+    }
+
+    // A zlib stream of uncompressed deflate blocks, these images are small and written once
+    ByteBuffer zlib = {};
+    appendByte(&zlib, 0x78);
+    appendByte(&zlib, 0x01);
+    size_t offset = 0;
+    do
+    {
+        size_t blockSize = std::min(raw.size - offset, (size_t)65535);
+        bool isLast = offset + blockSize == raw.size;
+        appendByte(&zlib, isLast ? 1 : 0);
+        appendU16(&zlib, (int)blockSize);
+        appendU16(&zlib, (int)(~blockSize & 0xffff));
+        appendBytes(&zlib, raw.data + offset, blockSize);
+        offset += blockSize;
+    } while (offset < raw.size);
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < raw.size; ++i)
+    {
+        a = (a + raw.data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendU32BigEndian(&zlib, (b << 16) | a);
+
+    ByteBuffer header = {};
+    appendU32BigEndian(&header, (uint32_t)width);
+    appendU32BigEndian(&header, (uint32_t)height);
+    // 8 bits per channel, RGBA, no interlacing
+    const unsigned char headerRest[5] = { 8, 6, 0, 0, 0 };
+    appendBytes(&header, headerRest, sizeof headerRest);
+
+    ByteBuffer png = {};
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    appendBytes(&png, signature, sizeof signature);
+    appendPngChunk(&png, "IHDR", &header);
+    appendPngChunk(&png, "IDAT", &zlib);
+    ByteBuffer end = {};
+    appendPngChunk(&png, "IEND", &end);
+
+    bool isOk = false;
+    FILE* file = fopen(filename, "wb");
+    if (file)
+    {
+        isOk = fwrite(png.data, 1, png.size, file) == png.size;
+        isOk = fclose(file) == 0 && isOk;
+    }
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    free(raw.data);
+    free(zlib.data);
+    free(header.data);
+    free(png.data);
+    return isOk;
+}
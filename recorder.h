@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Writes frames to an animated GIF or a raw Y4M video, chosen by the file extension. Frames are
+// encoded on worker threads (palette quantization and LZW for GIF, YUV 4:2:0 conversion for Y4M)
+// and written out in order.
+
+enum class RecordingFormat
+{
+    Gif,
+    Y4m,
+};
+
+constexpr int recorderWorkersCap = 4;
+constexpr int recorderJobsCap = 2 * recorderWorkersCap + 2;
+
+struct ByteBuffer
+{
+    unsigned char* data;
+    size_t size;
+    size_t cap;
+};
+
+enum class RecordJobState
+{
+    Free,
+    Filling,
+    Queued,
+    Encoding,
+    Encoded,
+};
+
+struct RecordJob
+{
+    RecordJobState state;
+    int frameIndex;
+    // RGBA, rows bottom to top
+    unsigned char* pixels;
+    ByteBuffer encoded;
+};
+
+struct Recorder
+{
+    FILE* file;
+    RecordingFormat format;
+    int width;
+    int height;
+    float fps;
+
+    // Frame sequence numbers, job i holds frames with sequence % numJobs == i. Guarded by the mutex.
+    RecordJob jobs[recorderJobsCap];
+    int numJobs;
+    int nextSequence;
+    int nextToEncode;
+    int nextToWrite;
+    bool isWriting;
+    bool isStopping;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread workers[recorderWorkersCap];
+    int numWorkers;
+
+    // Timestamp of the last recorded frame, in GIF delay units (1/100 s)
+    int lastGifTime;
+    int numFrames;
+};
+
+bool initRecorder(Recorder* r, const char* filename, int width, int height, float fps);
+
+// Frame indices are counted at the given fps and may skip frames. GIF can't show more than 50 frames
+// per second, faster frames are skipped. Blocks when all the workers are busy.
+void recordFrame(Recorder* r, const unsigned char* pixels, int frameIndex);
+
+// Waits for the queued frames and closes the file
+void finishRecorder(Recorder* r);
+
+// Pixels are RGBA, rows bottom to top
+bool writePpm(const char* filename, const unsigned char* rgba, int width, int height);
+bool writePng(const char* filename, const unsigned char* rgba, int width, int height);
@@ -0,0 +1,635 @@
+#include "renderer.h"
+#include "trace.h"
+
+#include <stb_image.h>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+static unsigned int loadTexture(const char* filename)
+{
+    unsigned int texture{};
+
+    int width, height, nrChannels;
+    unsigned char* data = stbi_load(filename, &width, &height, &nrChannels, 0);
+    if (data)
+    {
+        int format{};
+        switch (nrChannels)
+        {
+        case 1:
+            format = GL_RED;
+            break;
+        case 3:
+            format = GL_RGB;
+            break;
+        case 4:
+            format = GL_RGBA;
+            break;
+        default:
+            fprintf(stderr, "Unsupported number of channels: %d\n", nrChannels);
+            exit(1);
+            break;
+        }
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, (GLenum)format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    else
+    {
+        fprintf(stderr, "Failed to load texture\n");
+        exit(1);
+    }
+    stbi_image_free(data);
+    return texture;
+}
+
+static GLuint createShaderProgram(const char* vCode, const char* fCode)
+{
+    GLchar infoLog[512];
+    GLint success;
+
+    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vs, 1, &vCode, nullptr);
+    glCompileShader(vs);
+    glGetShaderiv(vs, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vs, sizeof(infoLog), nullptr, infoLog);
+        fprintf(stderr, "Vertex shader error:\n%s\n", infoLog);
+        exit(1);
+    }
+
+    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fs, 1, &fCode, nullptr);
+    glCompileShader(fs);
+    glGetShaderiv(fs, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(fs, sizeof(infoLog), nullptr, infoLog);
+        fprintf(stderr, "Fragment shader error:\n%s\n", infoLog);
+        exit(1);
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(program, sizeof(infoLog), nullptr, infoLog);
+        fprintf(stderr, "Program link error:\n%s\n", infoLog);
+        exit(1);
+    }
+
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    return program;
+}
+
+static MainShader createMainShader()
+{
+    static const char* const vertexCode = R"(
+#version 410
+
+layout (location = 0) in vec2 inPos; // normalized to [-1, 1]
+layout (location = 1) in vec4 inCol;
+
+out vec3 col;
+
+uniform mat3 model;
+uniform mat3 view;
+uniform mat4 projection;
+uniform float posRange;
+
+void main()
+{
+    col = inCol.rgb;
+    vec2 pos = inPos * posRange;
+    gl_Position = projection * vec4(view * model * vec3(pos, 1.0), 1.0);
+}
+)";
+
+    static const char* const fragmentCode = R"(
+#version 410
+
+in vec3 col;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = vec4(col, 1.0);
+}
+)";
+
+    MainShader ms = {};
+
+    ms.program = createShaderProgram(vertexCode, fragmentCode);
+
+    ms.modelLoc = glGetUniformLocation(ms.program, "model");
+    ms.viewLoc = glGetUniformLocation(ms.program, "view");
+    ms.projectionLoc = glGetUniformLocation(ms.program, "projection");
+    ms.posRangeLoc = glGetUniformLocation(ms.program, "posRange");
+
+    assert(ms.modelLoc >= 0);
+    assert(ms.viewLoc >= 0);
+    assert(ms.projectionLoc >= 0);
+    assert(ms.posRangeLoc >= 0);
+
+    return ms;
+}
+
+static FontShader createFontShader()
+{
+    static const char* const vCode = R"(
+#version 410
+
+layout (location = 0) in vec2 modelPos;
+layout (location = 1) in vec2 instanceWorldOffset;
+layout (location = 2) in vec2 instanceTexOffset;
+layout (location = 3) in vec4 instanceColor;
+
+uniform mat4 projection;
+uniform float scale;
+
+out vec2 texCoords;
+out vec2 texOffset;
+out vec3 color;
+
+void main()
+{
+    gl_Position = projection * vec4(modelPos * scale + instanceWorldOffset, 0.0, 1.0);
+    texCoords = modelPos;
+    texOffset = instanceTexOffset;
+    color = instanceColor.rgb;
+}
+)";
+
+    static const char* const fCode = R"(
+#version 410
+
+in vec2 texCoords;
+in vec2 texOffset;
+in vec3 color;
+
+uniform sampler2D fontTexture;
+uniform int fontRows;
+uniform int fontCols;
+
+out vec4 fragColor;
+
+void main()
+{
+    vec4 c = texture(fontTexture, vec2((texCoords.x + texOffset.x) / fontCols, (texCoords.y + texOffset.y) / fontRows));
+    if (c.a == 0.0) discard;
+    fragColor = vec4(color, 1.0);
+}
+)";
+
+    FontShader fs = {};
+
+    fs.program = createShaderProgram(vCode, fCode);
+
+    fs.projectionLoc = glGetUniformLocation(fs.program, "projection");
+    fs.scaleLoc = glGetUniformLocation(fs.program, "scale");
+    fs.fontTextureLoc = glGetUniformLocation(fs.program, "fontTexture");
+    fs.fontRowsLoc = glGetUniformLocation(fs.program, "fontRows");
+    fs.fontColsLoc = glGetUniformLocation(fs.program, "fontCols");
+
+    assert(fs.projectionLoc >= 0);
+    assert(fs.scaleLoc >= 0);
+    assert(fs.fontTextureLoc >= 0);
+    assert(fs.fontRowsLoc >= 0);
+    assert(fs.fontColsLoc >= 0);
+
+    return fs;
+}
+
+constexpr int numRectVerts = 6;
+
+static GLuint createVao(const DefaultVertex* verts, int numVerts, GLuint* vboOut = nullptr)
+{
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)numVerts * sizeof(verts[0]), verts, vboOut ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_SHORT, GL_TRUE, sizeof(verts[0]), (void *)offsetof(DefaultVertex, pos));
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(verts[0]), (void *)offsetof(DefaultVertex, col));
+
+    if (vboOut)
+    {
+        *vboOut = vbo;
+    }
+
+    return vao;
+}
+
+// Makes the bound dynamic vertex buffer big enough for numVerts, returns true when it had to be
+// allocated again and lost its contents
+static bool reserveVerts(int* cap, int numVerts)
+{
+    if (numVerts <= *cap)
+    {
+        return false;
+    }
+    glBufferData(GL_ARRAY_BUFFER, (size_t)numVerts * sizeof(DefaultVertex), nullptr, GL_DYNAMIC_DRAW);
+    *cap = numVerts;
+    return true;
+}
+
+static void APIENTRY glDebugOutput(
+    GLenum source,
+    GLenum type,
+    GLuint id,
+    GLenum severity,
+    GLsizei /*length*/,
+    const GLchar* message,
+    const void* /*userParam*/)
+{
+    // Skip uninteresting messages
+    if (id == 131185) // Buffer object will use VIDEO memory as the source for buffer object operations
+        return;
+
+    fprintf(stderr, "\nOpenGL debug message (%u): %s\n", id, message);
+
+    switch (source)
+    {
+    case GL_DEBUG_SOURCE_API:             fprintf(stderr, "Source: API\n"); break;
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   fprintf(stderr, "Source: Window System\n"); break;
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: fprintf(stderr, "Source: Shader Compiler\n"); break;
+    case GL_DEBUG_SOURCE_THIRD_PARTY:     fprintf(stderr, "Source: Third Party\n"); break;
+    case GL_DEBUG_SOURCE_APPLICATION:     fprintf(stderr, "Source: Application\n"); break;
+    case GL_DEBUG_SOURCE_OTHER:           fprintf(stderr, "Source: Other\n"); break;
+    default:                              fprintf(stderr, "Source: ???\n"); break;
+    }
+
+    switch (type)
+    {
+    case GL_DEBUG_TYPE_ERROR:               fprintf(stderr, "Type: Error\n"); break;
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: fprintf(stderr, "Type: Deprecated Behaviour\n"); break;
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  fprintf(stderr, "Type: Undefined Behaviour\n"); break;
+    case GL_DEBUG_TYPE_PORTABILITY:         fprintf(stderr, "Type: Portability\n"); break;
+    case GL_DEBUG_TYPE_PERFORMANCE:         fprintf(stderr, "Type: Performance\n"); break;
+    case GL_DEBUG_TYPE_MARKER:              fprintf(stderr, "Type: Marker\n"); break;
+    case GL_DEBUG_TYPE_PUSH_GROUP:          fprintf(stderr, "Type: Push Group\n"); break;
+    case GL_DEBUG_TYPE_POP_GROUP:           fprintf(stderr, "Type: Pop Group\n"); break;
+    case GL_DEBUG_TYPE_OTHER:               fprintf(stderr, "Type: Other\n"); break;
+    default:                                fprintf(stderr, "Type: ???\n"); break;
+    }
+
+    switch (severity)
+    {
+    case GL_DEBUG_SEVERITY_HIGH:         fprintf(stderr, "Severity: high\n"); break;
+    case GL_DEBUG_SEVERITY_MEDIUM:       fprintf(stderr, "Severity: medium\n"); break;
+    case GL_DEBUG_SEVERITY_LOW:          fprintf(stderr, "Severity: low\n"); break;
+    case GL_DEBUG_SEVERITY_NOTIFICATION: fprintf(stderr, "Severity: notification\n"); break;
+    default:                             fprintf(stderr, "Severity: ???\n"); break;
+    }
+}
+
+// Reads the queries of the set if the GPU is done with them, without waiting
+static void collectGpuTimes(Renderer* r, int set)
+{
+    r->hasGpuTimes = false;
+    if (r->numTimedFrames < gpuTimerFramesCap)
+    {
+        return;
+    }
+
+    // The groups finish in order, once the last one has they all have
+    GLuint isAvailable = 0;
+    glGetQueryObjectuiv(r->timerQueries[set][numGpuTimerGroups - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+    if (!isAvailable)
+    {
+        // Dropped, the queries are issued again this frame
+        return;
+    }
+
+    for (int group = 0; group < numGpuTimerGroups; ++group)
+    {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(r->timerQueries[set][group], GL_QUERY_RESULT, &ns);
+        r->gpuTimes[group] = (double)ns * 1e-9;
+    }
+    r->hasGpuTimes = true;
+}
+
+static double getSeconds()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void beginGpuGroup(Renderer* r, GpuTimerGroup group)
+{
+    if (r->isFinishTiming)
+    {
+        // The work before the group isn't counted in it
+        glFinish();
+        r->gpuTimes[group] = getSeconds();
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, r->timerQueries[r->numTimedFrames % gpuTimerFramesCap][group]);
+}
+
+static void endGpuGroup(Renderer* r, GpuTimerGroup group)
+{
+    if (r->isFinishTiming)
+    {
+        glFinish();
+        r->gpuTimes[group] = getSeconds() - r->gpuTimes[group];
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+bool isSoftwareRenderer()
+{
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    return renderer && (strstr(renderer, "llvmpipe") || strstr(renderer, "softpipe") || strstr(renderer, "SwiftShader"));
+}
+
+void render(Renderer* r, RenderData* rd)
+{
+    if (!r->isFinishTiming)
+    {
+        collectGpuTimes(r, r->numTimedFrames % gpuTimerFramesCap);
+    }
+
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glUseProgram(r->mainShader.program);
+
+    // Draw moving circles
+    beginGpuGroup(r, gpuCircles);
+    for (int i = 0; i < numCircles; ++i)
+    {
+        Circle c = rd->circles[i];
+
+        float m[9] = {};
+        m[0] = c.r;   m[3] = 0.0f;  m[6] = c.p.x;
+        m[1] = 0.0f;  m[4] = c.r;   m[7] = c.p.y;
+        m[2] = 0.0f;  m[5] = 0.0f;  m[8] = 1.0f;
+        glUniformMatrix3fv(r->mainShader.modelLoc, 1, GL_FALSE, m);
+
+        glBindVertexArray(r->circleVao);
+        glDrawArrays(GL_LINE_LOOP, 0, numCircleVerts);
+    }
+    endGpuGroup(r, gpuCircles);
+
+    // Draw flippers
+    beginGpuGroup(r, gpuFlippers);
+    for (int i = 0; i < numFlippers; ++i)
+    {
+        glUniformMatrix3fv(r->mainShader.modelLoc, 1, GL_FALSE, &rd->flipperTransforms[i].m[0][0]);
+        glBindVertexArray(r->flipperVao);
+        glDrawArrays(GL_LINE_LOOP, 0, numFlipperVerts);
+    }
+    endGpuGroup(r, gpuFlippers);
+
+    // Static and dynamic lines are timed together
+    beginGpuGroup(r, gpuLines);
+
+    // Draw static lines
+    {
+        TRACE_SCOPE("static lines");
+        Mat3 reflection = I3;
+        reflection.m[0][0] = -1.0f;
+        glBindVertexArray(r->staticLineVao);
+        glUniformMatrix3fv(r->mainShader.modelLoc, 1, GL_FALSE, &I3.m[0][0]);
+        glDrawArrays(GL_LINES, 0, rd->numStaticLineVerts);
+        glUniformMatrix3fv(r->mainShader.modelLoc, 1, GL_FALSE, &reflection.m[0][0]);
+        glDrawArrays(GL_LINES, 0, rd->numMirroredLineVerts);
+    }
+
+    // Draw lines
+    {
+        TRACE_SCOPE("lines");
+        glUniformMatrix3fv(r->mainShader.modelLoc, 1, GL_FALSE, &I3.m[0][0]);
+        glBindVertexArray(r->lineVao);
+        glBindBuffer(GL_ARRAY_BUFFER, r->lineVbo);
+        reserveVerts(&r->lineVboCap, rd->numLineVerts);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (size_t)rd->numLineVerts * sizeof(rd->lineVerts[0]), rd->lineVerts);
+        glDrawArrays(GL_LINES, 0, rd->numLineVerts);
+    }
+    endGpuGroup(r, gpuLines);
+
+    // Draw ditch lids
+    beginGpuGroup(r, gpuDitchLids);
+    {
+        DefaultVertex verts[ditchLidsCap * 2] = {};
+        for (int i = 0; i < rd->numDitchLids; ++i)
+        {
+            verts[i * 2] = makeVertex(rd->ditchLids[i].p0, defCol);
+            verts[i * 2 + 1] = makeVertex(rd->ditchLids[i].p1, defCol);
+        }
+        int numVerts = rd->numDitchLids * 2;
+        glBindVertexArray(r->ditchLidsVao);
+        glBindBuffer(GL_ARRAY_BUFFER, r->ditchLidsVbo);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (size_t)numVerts * sizeof(verts[0]), verts);
+        glUniformMatrix3fv(r->mainShader.modelLoc, 1, GL_FALSE, &I3.m[0][0]);
+        glDrawArrays(GL_LINES, 0, numVerts);
+    }
+    endGpuGroup(r, gpuDitchLids);
+
+    // Draw the plunger
+    beginGpuGroup(r, gpuPlunger);
+    {
+        float m[9] = {};
+        m[0] = 1.0f;  m[3] = 0.0f;              m[6] = rd->plungerCenterX;
+        m[1] = 0.0f;  m[4] = rd->plungerScaleY;  m[7] = 0.0f;
+        m[2] = 0.0f;  m[5] = 0.0f;              m[8] = 1.0f;
+        glBindVertexArray(r->plungerVao);
+        glUniformMatrix3fv(r->mainShader.modelLoc, 1, GL_FALSE, m);
+        glDrawArrays(GL_LINE_STRIP, 0, numPlungerVerts);
+    }
+    endGpuGroup(r, gpuPlunger);
+
+    // Draw debug lines
+    beginGpuGroup(r, gpuDebug);
+    {
+        glBindVertexArray(r->debugVao);
+        glBindBuffer(GL_ARRAY_BUFFER, r->debugVbo);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (size_t)rd->numDebugVerts * sizeof(rd->debugVerts[0]), rd->debugVerts);
+        glUniformMatrix3fv(r->mainShader.modelLoc, 1, GL_FALSE, &I3.m[0][0]);
+        glDrawArrays(GL_LINES, 0, rd->numDebugVerts);
+    }
+    endGpuGroup(r, gpuDebug);
+
+    // Draw the text
+    TRACE_SCOPE("text");
+    // On the CPU, kept out of the group for finish timing
+    if (rd->isTextDirty)
+    {
+        layoutText(rd);
+    }
+    beginGpuGroup(r, gpuText);
+    glUseProgram(r->fontShader.program);
+    glBindVertexArray(r->fontVao);
+    if (r->textVersion != rd->textVersion)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, r->fontInstanceVbo);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (size_t)rd->numChars * sizeof(rd->charInstances[0]), rd->charInstances);
+        r->textVersion = rd->textVersion;
+    }
+    glBindTexture(GL_TEXTURE_2D, r->fontTexture);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, numRectVerts, rd->numChars);
+    endGpuGroup(r, gpuText);
+
+    if (r->isFinishTiming)
+    {
+        r->hasGpuTimes = true;
+    }
+    ++r->numTimedFrames;
+}
+
+void updateStaticLines(Renderer* r, const RenderData* rd, int firstVert, int numVerts)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, r->staticLineVbo);
+    if (reserveVerts(&r->staticLineVboCap, rd->numStaticLineVerts))
+    {
+        // The new buffer starts out empty
+        firstVert = 0;
+        numVerts = rd->numStaticLineVerts;
+    }
+    assert(firstVert + numVerts <= r->staticLineVboCap);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)((size_t)firstVert * sizeof(DefaultVertex)),
+        (GLsizeiptr)((size_t)numVerts * sizeof(DefaultVertex)), &rd->staticLineVerts[firstVert]);
+}
+
+void initRenderer(Renderer* r, const RenderData* rd)
+{
+    *r = {};
+    r->textVersion = -1;
+
+    stbi_set_flip_vertically_on_load_thread(true);
+
+    // Initialize render data
+    {
+        r->mainShader = createMainShader();
+        r->fontShader = createFontShader();
+
+        r->staticLineVao = createVao(nullptr, rd->numStaticLineVerts, &r->staticLineVbo);
+        r->staticLineVboCap = rd->numStaticLineVerts;
+        updateStaticLines(r, rd, 0, rd->numStaticLineVerts);
+
+        // Sized by the first frame
+        r->lineVao = createVao(nullptr, 0, &r->lineVbo);
+
+        glGenQueries(gpuTimerFramesCap * numGpuTimerGroups, &r->timerQueries[0][0]);
+
+        DefaultVertex circleVerts[numCircleVerts];
+        makeCircleVerts(circleVerts);
+        r->circleVao = createVao(circleVerts, numCircleVerts);
+
+        DefaultVertex flipperVerts[numFlipperVerts];
+        makeFlipperVerts(flipperVerts);
+        r->flipperVao = createVao(flipperVerts, numFlipperVerts);
+
+        DefaultVertex plungerVerts[numPlungerVerts];
+        makePlungerVerts(plungerVerts);
+        r->plungerVao = createVao(plungerVerts, numPlungerVerts);
+
+        r->debugVao = createVao(nullptr, debugVertsCap, &r->debugVbo);
+
+        r->ditchLidsVao = createVao(nullptr, ditchLidsCap * 2, &r->ditchLidsVbo);
+
+        //
+        // Font stuff
+        //
+        {
+            r->fontTexture = loadTexture("MyFont.png");
+
+            glGenVertexArrays(1, &r->fontVao);
+            glBindVertexArray(r->fontVao);
+
+            float rectVerts[numRectVerts * 2]{
+                0.0f, 0.0f, // left-bottom
+                1.0f, 1.0f, // right-top
+                0.0f, 1.0f, // left-top
+
+                0.0f, 0.0f, // left-bottom
+                1.0f, 0.0f, // right-bottom
+                1.0f, 1.0f, // right-top
+            };
+            GLuint vbo;
+            glGenBuffers(1, &vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, sizeof rectVerts, rectVerts, GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+            glEnableVertexAttribArray(0);
+
+            glGenBuffers(1, &r->fontInstanceVbo);
+            glBindBuffer(GL_ARRAY_BUFFER, r->fontInstanceVbo);
+            glBufferData(GL_ARRAY_BUFFER, charInstanceCap * sizeof(FontCharInstance), nullptr, GL_DYNAMIC_DRAW);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(FontCharInstance), (void*)offsetof(FontCharInstance, worldOffset));
+            glVertexAttribPointer(2, 2, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(FontCharInstance), (void*)offsetof(FontCharInstance, texOffset));
+            glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(FontCharInstance), (void*)offsetof(FontCharInstance, color));
+            glEnableVertexAttribArray(1);
+            glEnableVertexAttribArray(2);
+            glEnableVertexAttribArray(3);
+            glVertexAttribDivisor(1, 1);
+            glVertexAttribDivisor(2, 1);
+            glVertexAttribDivisor(3, 1);
+        }
+    }
+
+    // Initialize uniforms for the main shader program
+    {
+        Mat4 projection{ myOrtho(Constants::worldL, Constants::worldR, Constants::worldB, Constants::worldT, -1.0f, 1.0f) };
+        glUseProgram(r->mainShader.program);
+        Mat3 view = I3;
+        view.m[2][0] = -10.0f;
+        glUniformMatrix3fv(r->mainShader.viewLoc, 1, GL_FALSE, &view.m[0][0]);
+        glUniformMatrix4fv(r->mainShader.projectionLoc, 1, GL_FALSE, &projection.m[0][0]);
+        glUniform1f(r->mainShader.posRangeLoc, vertexPosRange);
+        glUseProgram(0);
+    }
+
+    // Initialize uniforms for the font shader program
+    {
+        auto& fs = r->fontShader;
+        glUseProgram(fs.program);
+        Mat4 textProjection{ myOrtho(0.0f, (float)scrWidth, 0.0f, (float)scrHeight, -1.0f, 1.0f) };
+        glUniformMatrix4fv(fs.projectionLoc, 1, GL_FALSE, &textProjection.m[0][0]);
+        glUniform1f(fs.scaleLoc, letterSize);
+        glUniform1i(fs.fontTextureLoc, 0);
+        glUniform1i(fs.fontRowsLoc, fontRows);
+        glUniform1i(fs.fontColsLoc, fontCols);
+        glUseProgram(0);
+    }
+}
+
+void enableGlDebugOutput()
+{
+    if (GLAD_GL_KHR_debug)
+    {
+        glEnable(GL_DEBUG_OUTPUT);
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(glDebugOutput, nullptr);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "game.h"
+
+#include <glad/glad.h>
+
+struct MainShader
+{
+    GLuint program;
+
+    GLint modelLoc;
+    GLint viewLoc;
+    GLint projectionLoc;
+    GLint posRangeLoc;
+};
+
+struct FontShader
+{
+    GLuint program;
+
+    GLint projectionLoc;
+    GLint scaleLoc;
+    GLint fontTextureLoc;
+    GLint fontRowsLoc;
+    GLint fontColsLoc;
+};
+
+// Draw groups timed with GL_TIME_ELAPSED queries
+enum GpuTimerGroup
+{
+    gpuCircles,
+    gpuFlippers,
+    gpuLines,
+    gpuDitchLids,
+    gpuPlunger,
+    gpuDebug,
+    gpuText,
+    numGpuTimerGroups,
+};
+
+// Queries of a frame are read back this many frames later, so reading them doesn't wait for the GPU
+constexpr int gpuTimerFramesCap = 2;
+
+// OpenGL objects used to draw RenderData
+struct Renderer
+{
+    MainShader mainShader;
+    FontShader fontShader;
+
+    // Vertex buffers sized to the table, they grow when a bigger one is reloaded
+    GLuint staticLineVao;
+    GLuint staticLineVbo;
+    int staticLineVboCap;
+
+    GLuint lineVao;
+    GLuint lineVbo;
+    int lineVboCap;
+
+    GLuint ditchLidsVao;
+    GLuint ditchLidsVbo;
+
+    GLuint circleVao;
+    GLuint flipperVao;
+    GLuint plungerVao;
+
+    GLuint debugVao;
+    GLuint debugVbo;
+
+    GLuint fontVao;
+    GLuint fontInstanceVbo;
+    GLuint fontTexture;
+
+    // RenderData::textVersion of the glyphs in fontInstanceVbo
+    int textVersion;
+
+    // A set of queries per frame in flight
+    GLuint timerQueries[gpuTimerFramesCap][numGpuTimerGroups];
+    int numTimedFrames;
+    // In seconds, of the frame gpuTimerFramesCap renders ago. Not there when the GPU hadn't finished
+    // it yet, or for the first frames.
+    double gpuTimes[numGpuTimerGroups];
+    bool hasGpuTimes;
+    // Time each group on the CPU between two glFinish() calls instead, the times are of the frame just
+    // rendered. For software drivers like llvmpipe, which rasterize at the flush so the queries bracket
+    // no work. Stalls the pipeline at every group, so it's off unless asked for.
+    bool isFinishTiming;
+};
+
+// Requires a current OpenGL 4.1 context, static lines of rd are uploaded once here
+void initRenderer(Renderer* r, const RenderData* rd);
+void render(Renderer* r, RenderData* rd);
+// Uploads a range of the static lines again after reloadTable()
+void updateStaticLines(Renderer* r, const RenderData* rd, int firstVert, int numVerts);
+
+void enableGlDebugOutput();
+// Whether the context renders on the CPU (llvmpipe, softpipe, SwiftShader), where the timer queries
+// don't attribute anything to the draw groups
+bool isSoftwareRenderer();
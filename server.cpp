@@ -0,0 +1,472 @@
+// Serves vectorized environments to trainers in other processes through shared memory, see envshm.h.
+// With --client it's a benchmark trainer instead, driving a running server.
+
+#include "envshm.h"
+#include "game.h"
+#include "observation.h"
+#include "tablefile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+struct ServerOptions
+{
+    const char* name;
+    const char* clientName;
+    int numEnvs;
+    int obsSize;
+    int numSteps;
+    int numTicks;
+    unsigned int seed;
+    const char* tableFilename;
+};
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: my_pinball_server [options]\n"
+        "  --name NAME    shared memory object to create (default /my_pinball)\n"
+        "  --envs N       number of environments (default 64)\n"
+        "  --obs-size N   also render N x N grayscale observations (default 0, features only)\n"
+        "  --seed N       random seed (default 1)\n"
+        "  --table F      load the table from F, a text or baked table (see tablefile.h)\n"
+        "       my_pinball_server --client NAME [options]\n"
+        "  --steps N      steps to run (default 10000)\n"
+        "  --ticks N      simulation ticks per step (default 4, up to 1200)\n");
+}
+
+static bool parseOptions(int argc, char** argv, ServerOptions* opts)
+{
+    *opts = {};
+    opts->name = "/my_pinball";
+    opts->numEnvs = 64;
+    opts->numSteps = 10000;
+    opts->numTicks = 4;
+    opts->seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            return false;
+        }
+        ++i;
+
+        if (strcmp(arg, "--name") == 0)
+        {
+            opts->name = value;
+        }
+        else if (strcmp(arg, "--client") == 0)
+        {
+            opts->clientName = value;
+        }
+        else if (strcmp(arg, "--envs") == 0)
+        {
+            opts->numEnvs = atoi(value);
+        }
+        else if (strcmp(arg, "--obs-size") == 0)
+        {
+            opts->obsSize = atoi(value);
+        }
+        else if (strcmp(arg, "--steps") == 0)
+        {
+            opts->numSteps = atoi(value);
+        }
+        else if (strcmp(arg, "--ticks") == 0)
+        {
+            opts->numTicks = atoi(value);
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            opts->seed = (unsigned int)strtoul(value, nullptr, 10);
+        }
+        else if (strcmp(arg, "--table") == 0)
+        {
+            opts->tableFilename = value;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return opts->numEnvs > 0 && opts->obsSize >= 0 && opts->obsSize <= 1024 && opts->numSteps > 0 && opts->numTicks > 0 &&
+        opts->numTicks <= (int)envTicksMax;
+}
+
+static double getSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+//
+// Futex
+//
+
+// Sleeps while the word equals expected, or until the timeout
+static void futexWait(std::atomic<uint32_t>* word, uint32_t expected, long timeoutMs)
+{
+    timespec timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000000 };
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+static void futexWakeAll(std::atomic<uint32_t>* word)
+{
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+// Spins a little before sleeping, a step of a small batch takes microseconds
+static uint32_t waitForChange(std::atomic<uint32_t>* word, uint32_t value, volatile sig_atomic_t* isStopping)
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        uint32_t current = word->load(std::memory_order_acquire);
+        if (current != value)
+        {
+            return current;
+        }
+    }
+    for (;;)
+    {
+        uint32_t current = word->load(std::memory_order_acquire);
+        if (current != value || (isStopping && *isStopping))
+        {
+            return current;
+        }
+        futexWait(word, value, 100);
+    }
+}
+
+//
+// Layout
+//
+
+static uint64_t alignUp(uint64_t offset)
+{
+    return (offset + 63) & ~(uint64_t)63;
+}
+
+static void initLayout(EnvShmHeader* h, int numEnvs, int obsSize)
+{
+    uint64_t n = (uint64_t)numEnvs;
+
+    h->magic = envShmMagic;
+    h->version = envShmVersion;
+    h->numEnvs = (uint32_t)numEnvs;
+    h->numFeatures = numObservationFeatures;
+    h->obsWidth = (uint32_t)obsSize;
+    h->obsHeight = (uint32_t)obsSize;
+
+    uint64_t offset = alignUp(sizeof(EnvSlotHeader));
+    h->actionsOffset = offset;
+    offset = alignUp(offset + n);
+    h->featuresOffset = offset;
+    offset = alignUp(offset + n * numObservationFeatures * sizeof(float));
+    h->rewardsOffset = offset;
+    offset = alignUp(offset + n * sizeof(float));
+    h->donesOffset = offset;
+    offset = alignUp(offset + n);
+    h->imagesOffset = offset;
+    offset = alignUp(offset + n * (uint64_t)obsSize * (uint64_t)obsSize);
+
+    h->slotStride = offset;
+    h->slotsOffset = alignUp(sizeof(EnvShmHeader));
+    h->totalSize = h->slotsOffset + envRingSize * h->slotStride;
+}
+
+static unsigned char* getSlot(EnvShmHeader* h, uint32_t request)
+{
+    return (unsigned char*)h + h->slotsOffset + (request % envRingSize) * h->slotStride;
+}
+
+//
+// Server
+//
+
+static volatile sig_atomic_t g_isStopping = 0;
+
+static void handleSignal(int /*signal*/)
+{
+    g_isStopping = 1;
+}
+
+static int runServer(const ServerOptions& opts)
+{
+    // Before the shared memory, so a bad table leaves nothing behind in /dev/shm
+    Table table;
+    if (!initTable(&table, opts.tableFilename))
+    {
+        return 1;
+    }
+
+    EnvShmHeader layout = {};
+    initLayout(&layout, opts.numEnvs, opts.obsSize);
+
+    int fd = shm_open(opts.name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd < 0 || ftruncate(fd, (off_t)layout.totalSize) != 0)
+    {
+        fprintf(stderr, "Failed to create shared memory %s: %s\n", opts.name, strerror(errno));
+        freeTable(&table);
+        return 1;
+    }
+    void* mapping = mmap(nullptr, layout.totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map shared memory: %s\n", strerror(errno));
+        shm_unlink(opts.name);
+        freeTable(&table);
+        return 1;
+    }
+
+    EnvShmHeader* h = (EnvShmHeader*)mapping;
+    memcpy((void*)h, &layout, offsetof(EnvShmHeader, numRequests));
+    h->numRequests.store(0);
+    h->numResponses.store(0);
+
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+
+    Game* games = (Game*)malloc((size_t)opts.numEnvs * sizeof(Game));
+    for (int i = 0; i < opts.numEnvs; ++i)
+    {
+        initGame(&games[i], &table, opts.seed + (unsigned int)i);
+    }
+
+    ObservationRenderer obs = {};
+    if (opts.obsSize > 0)
+    {
+        initObservationRenderer(&obs, &table, opts.obsSize, opts.obsSize);
+    }
+
+    printf("Serving %d environments on %s (%llu bytes)\n", opts.numEnvs, opts.name, (unsigned long long)h->totalSize);
+    fflush(stdout);
+
+    uint32_t numResponses = 0;
+    for (;;)
+    {
+        waitForChange(&h->numRequests, numResponses, &g_isStopping);
+        if (g_isStopping)
+        {
+            break;
+        }
+
+        unsigned char* slot = getSlot(h, numResponses);
+        const EnvSlotHeader* request = (const EnvSlotHeader*)slot;
+        // Read once, the client can write the slot at any time. A request for more ticks isn't allowed to
+        // stall the server.
+        uint32_t command = request->command;
+        uint32_t numTicks = request->numTicks;
+        numTicks = numTicks < envTicksMax ? numTicks : envTicksMax;
+        if (command == envCommandShutdown)
+        {
+            break;
+        }
+
+        const uint8_t* actions = slot + h->actionsOffset;
+        float* features = (float*)(slot + h->featuresOffset);
+        float* rewards = (float*)(slot + h->rewardsOffset);
+        uint8_t* dones = slot + h->donesOffset;
+
+        for (int i = 0; i < opts.numEnvs; ++i)
+        {
+            Game* game = &games[i];
+            rewards[i] = 0.0f;
+            dones[i] = 0;
+
+            // Started over games continue their random sequence, so every episode plays out differently
+            if (command == envCommandReset)
+            {
+                initGame(game, &table, game->randomState);
+                continue;
+            }
+
+            GameInput input = {};
+            input.isLeftButtonDown = (actions[i] & envActionLeft) != 0;
+            input.isRightButtonDown = (actions[i] & envActionRight) != 0;
+
+            int scoreBefore = game->score;
+            for (uint32_t tick = 0; tick < numTicks; ++tick)
+            {
+                updateGame(game, input, simDt);
+            }
+            rewards[i] = (float)(game->score - scoreBefore);
+
+            if (game->isGameOver)
+            {
+                dones[i] = 1;
+                initGame(game, &table, game->randomState);
+            }
+        }
+
+        getObservationFeatures(games, opts.numEnvs, features);
+        if (opts.obsSize > 0)
+        {
+            renderObservations(&obs, games, opts.numEnvs, slot + h->imagesOffset);
+        }
+
+        h->numResponses.store(++numResponses, std::memory_order_release);
+        futexWakeAll(&h->numResponses);
+    }
+
+    printf("Served %u requests\n", numResponses);
+
+    if (opts.obsSize > 0)
+    {
+        freeObservationRenderer(&obs);
+    }
+    free(games);
+    freeTable(&table);
+    munmap(mapping, layout.totalSize);
+    shm_unlink(opts.name);
+
+    return 0;
+}
+
+//
+// Client
+//
+
+static uint32_t submitRequest(EnvShmHeader* h, uint32_t command, uint32_t numTicks, const uint8_t* actions)
+{
+    uint32_t request = h->numRequests.load(std::memory_order_relaxed);
+    // Don't overwrite a slot the server hasn't answered yet
+    for (;;)
+    {
+        uint32_t numResponses = h->numResponses.load(std::memory_order_acquire);
+        if (request - numResponses < envRingSize)
+        {
+            break;
+        }
+        waitForChange(&h->numResponses, numResponses, nullptr);
+    }
+
+    unsigned char* slot = getSlot(h, request);
+    EnvSlotHeader* header = (EnvSlotHeader*)slot;
+    header->command = command;
+    header->numTicks = numTicks;
+    if (actions)
+    {
+        memcpy(slot + h->actionsOffset, actions, h->numEnvs);
+    }
+
+    h->numRequests.store(request + 1, std::memory_order_release);
+    futexWakeAll(&h->numRequests);
+    return request;
+}
+
+static unsigned char* waitForResponse(EnvShmHeader* h, uint32_t request)
+{
+    for (;;)
+    {
+        uint32_t numResponses = h->numResponses.load(std::memory_order_acquire);
+        if ((int32_t)(numResponses - request) > 0)
+        {
+            return getSlot(h, request);
+        }
+        waitForChange(&h->numResponses, numResponses, nullptr);
+    }
+}
+
+static int runClient(const ServerOptions& opts)
+{
+    int fd = shm_open(opts.clientName, O_RDWR, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Failed to open shared memory %s: %s\n", opts.clientName, strerror(errno));
+        return 1;
+    }
+    EnvShmHeader layout;
+    if (read(fd, &layout, offsetof(EnvShmHeader, numRequests)) != (ssize_t)offsetof(EnvShmHeader, numRequests) ||
+        layout.magic != envShmMagic || layout.version != envShmVersion)
+    {
+        fprintf(stderr, "%s isn't a my_pinball_server object\n", opts.clientName);
+        return 1;
+    }
+    void* mapping = mmap(nullptr, layout.totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map shared memory: %s\n", strerror(errno));
+        return 1;
+    }
+    EnvShmHeader* h = (EnvShmHeader*)mapping;
+    uint32_t numEnvs = h->numEnvs;
+
+    uint8_t* actions = (uint8_t*)malloc(numEnvs);
+    waitForResponse(h, submitRequest(h, envCommandReset, 0, nullptr));
+
+    // Keep two steps in flight, picking actions from the observations of the step before
+    double totalReward = 0.0;
+    int numDones = 0;
+    memset(actions, envActionRight, numEnvs);
+    uint32_t pending = submitRequest(h, envCommandStep, (uint32_t)opts.numTicks, actions);
+
+    double startTime = getSeconds();
+    for (int step = 1; step <= opts.numSteps; ++step)
+    {
+        uint32_t next = 0;
+        if (step < opts.numSteps)
+        {
+            next = submitRequest(h, envCommandStep, (uint32_t)opts.numTicks, actions);
+        }
+
+        const unsigned char* slot = waitForResponse(h, pending);
+        const float* features = (const float*)(slot + h->featuresOffset);
+        const float* rewards = (const float*)(slot + h->rewardsOffset);
+        const uint8_t* dones = slot + h->donesOffset;
+        for (uint32_t i = 0; i < numEnvs; ++i)
+        {
+            const float* f = features + i * h->numFeatures;
+            totalReward += rewards[i];
+            numDones += dones[i];
+
+            // Pull the plunger until it's down, flip when the ball is low and falling
+            uint8_t action = 0;
+            if (f[obsPlungerT] < 1.0f && f[obsBallY] < 5.0f && f[obsBallX] > 20.0f)
+            {
+                action = envActionRight;
+            }
+            else if (f[obsBallY] < 12.0f && f[obsBallVelocityY] < 0.0f)
+            {
+                action = f[obsBallX] < 0.0f ? envActionLeft : envActionRight;
+            }
+            actions[i] = action;
+        }
+        pending = next;
+    }
+    double elapsed = getSeconds() - startTime;
+
+    double numEnvSteps = (double)opts.numSteps * numEnvs;
+    printf("%d steps x %u envs in %.3f s, %.0f env steps/s, %.1f us per step, reward %.0f, %d games over\n",
+        opts.numSteps, numEnvs, elapsed, numEnvSteps / elapsed, elapsed * 1e6 / opts.numSteps, totalReward, numDones);
+
+    free(actions);
+    munmap(mapping, layout.totalSize);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    ServerOptions opts;
+    if (!parseOptions(argc, argv, &opts))
+    {
+        printUsage();
+        return 1;
+    }
+    return opts.clientName ? runClient(opts) : runServer(opts);
+}
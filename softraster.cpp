@@ -0,0 +1,440 @@
+#include "softraster.h"
+#include "trace.h"
+
+#include <stb_image.h>
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+static Vec2 unpackVertexPos(const DefaultVertex& v)
+{
+    return {
+        (float)v.pos[0] / 32767.0f * vertexPosRange,
+        (float)v.pos[1] / 32767.0f * vertexPosRange,
+    };
+}
+
+// Same transform as the main shader: the view shifts the table left to make room for the HUD
+static Vec2 worldToPixel(const SoftRenderer* r, Vec2 p)
+{
+    constexpr float viewX = -10.0f;
+    return {
+        (p.x + viewX - Constants::worldL) / Constants::worldSize * (float)r->width,
+        (p.y - Constants::worldB) / Constants::worldSize * (float)r->height,
+    };
+}
+
+static void addSegment(SoftRenderer* r, Vec2 p0, Vec2 p1, Rgba8 color)
+{
+    assert(r->numSegments < r->segmentsCap);
+    r->segments[r->numSegments++] = { worldToPixel(r, p0), worldToPixel(r, p1), color };
+}
+
+// Lines take the color of their first vertex, the GL renderer interpolates but nothing uses two colors
+static void addLines(SoftRenderer* r, const DefaultVertex* verts, int numVerts, const Mat3& model)
+{
+    for (int i = 0; i + 1 < numVerts; i += 2)
+    {
+        Vec3 p0 = model * Vec3{ unpackVertexPos(verts[i]).x, unpackVertexPos(verts[i]).y, 1.0f };
+        Vec3 p1 = model * Vec3{ unpackVertexPos(verts[i + 1]).x, unpackVertexPos(verts[i + 1]).y, 1.0f };
+        addSegment(r, { p0.x, p0.y }, { p1.x, p1.y }, verts[i].col);
+    }
+}
+
+static void addLineStrip(SoftRenderer* r, const Vec2* verts, int numVerts, bool isLoop, const Mat3& model, Rgba8 color)
+{
+    int numLines = isLoop ? numVerts : numVerts - 1;
+    for (int i = 0; i < numLines; ++i)
+    {
+        Vec2 a = verts[i];
+        Vec2 b = verts[(i + 1) % numVerts];
+        Vec3 p0 = model * Vec3{ a.x, a.y, 1.0f };
+        Vec3 p1 = model * Vec3{ b.x, b.y, 1.0f };
+        addSegment(r, { p0.x, p0.y }, { p1.x, p1.y }, color);
+    }
+}
+
+//
+// Tiles
+//
+
+static void getSegmentTiles(const SoftRenderer* r, const SoftSegment& s, int* tx0, int* ty0, int* tx1, int* ty1)
+{
+    float minX = fminf(s.p0.x, s.p1.x);
+    float maxX = fmaxf(s.p0.x, s.p1.x);
+    float minY = fminf(s.p0.y, s.p1.y);
+    float maxY = fmaxf(s.p0.y, s.p1.y);
+    *tx0 = std::max((int)floorf(minX) / softTileSize, 0);
+    *ty0 = std::max((int)floorf(minY) / softTileSize, 0);
+    *tx1 = std::min((int)floorf(maxX) / softTileSize, r->tilesX - 1);
+    *ty1 = std::min((int)floorf(maxY) / softTileSize, r->tilesY - 1);
+}
+
+static void binSegments(SoftRenderer* r)
+{
+    int numTiles = r->tilesX * r->tilesY;
+    for (int i = 0; i <= numTiles; ++i)
+    {
+        r->binStarts[i] = 0;
+    }
+
+    // Count, then place each segment into every tile its bounds overlap
+    for (int i = 0; i < r->numSegments; ++i)
+    {
+        int tx0, ty0, tx1, ty1;
+        getSegmentTiles(r, r->segments[i], &tx0, &ty0, &tx1, &ty1);
+        for (int ty = ty0; ty <= ty1; ++ty)
+        {
+            for (int tx = tx0; tx <= tx1; ++tx)
+            {
+                ++r->binStarts[ty * r->tilesX + tx + 1];
+            }
+        }
+    }
+    for (int i = 0; i < numTiles; ++i)
+    {
+        r->binStarts[i + 1] += r->binStarts[i];
+    }
+
+    int total = r->binStarts[numTiles];
+    if (total > r->binSegmentsCap)
+    {
+        r->binSegmentsCap = total * 2;
+        r->binSegments = (int*)realloc(r->binSegments, (size_t)r->binSegmentsCap * sizeof(int));
+    }
+
+    // initSoftRenderer() makes sure the tiles fit
+    static thread_local int fill[(softSizeMax / softTileSize) * (softSizeMax / softTileSize)];
+    assert((size_t)numTiles <= ARRAY_LEN(fill));
+    for (int i = 0; i < numTiles; ++i)
+    {
+        fill[i] = r->binStarts[i];
+    }
+    for (int i = 0; i < r->numSegments; ++i)
+    {
+        int tx0, ty0, tx1, ty1;
+        getSegmentTiles(r, r->segments[i], &tx0, &ty0, &tx1, &ty1);
+        for (int ty = ty0; ty <= ty1; ++ty)
+        {
+            for (int tx = tx0; tx <= tx1; ++tx)
+            {
+                r->binSegments[fill[ty * r->tilesX + tx]++] = i;
+            }
+        }
+    }
+}
+
+// Lights the pixel under the major axis position at every pixel center it crosses, like GL's
+// diamond exit rule the last pixel is left out. Only the part inside the tile is drawn.
+static void drawSegment(SoftRenderer* r, const SoftSegment& s, int x0, int y0, int x1, int y1)
+{
+    Vec2 a = s.p0;
+    Vec2 b = s.p1;
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+
+    bool isXMajor = fabsf(dx) >= fabsf(dy);
+    if (!isXMajor)
+    {
+        std::swap(a.x, a.y);
+        std::swap(b.x, b.y);
+        std::swap(dx, dy);
+    }
+    if (dx == 0.0f)
+    {
+        return;
+    }
+
+    float slope = dy / dx;
+    float start = fminf(a.x, b.x);
+    float end = fmaxf(a.x, b.x);
+    int first = (int)ceilf(start - 0.5f);
+    int last = (int)ceilf(end - 0.5f) - 1;
+
+    int majorMin = isXMajor ? x0 : y0;
+    int majorMax = isXMajor ? x1 : y1;
+    int minorMin = isXMajor ? y0 : x0;
+    int minorMax = isXMajor ? y1 : x1;
+    first = std::max(first, majorMin);
+    last = std::min(last, majorMax - 1);
+
+    for (int i = first; i <= last; ++i)
+    {
+        int j = (int)floorf(a.y + ((float)i + 0.5f - a.x) * slope);
+        if (j < minorMin || j >= minorMax)
+        {
+            continue;
+        }
+        int x = isXMajor ? i : j;
+        int y = isXMajor ? j : i;
+        r->pixels[y * r->width + x] = s.color;
+    }
+}
+
+// Nearest sampling of the font texture, like the font shader
+static void drawGlyphs(SoftRenderer* r, int x0, int y0, int x1, int y1)
+{
+    const RenderData* rd = r->rd;
+    float scale = (float)r->width / (float)scrWidth;
+    float glyphSize = letterSize * scale;
+    int cellWidth = r->fontWidth / fontCols;
+    int cellHeight = r->fontHeight / fontRows;
+
+    for (int i = 0; i < rd->numChars; ++i)
+    {
+        const FontCharInstance& c = rd->charInstances[i];
+        float gx = (float)c.worldOffset[0] * scale;
+        float gy = (float)c.worldOffset[1] * (float)r->height / (float)scrHeight;
+
+        int px0 = std::max((int)ceilf(gx - 0.5f), x0);
+        int py0 = std::max((int)ceilf(gy - 0.5f), y0);
+        int px1 = std::min((int)ceilf(gx + glyphSize - 0.5f), x1);
+        int py1 = std::min((int)ceilf(gy + glyphSize - 0.5f), y1);
+
+        for (int y = py0; y < py1; ++y)
+        {
+            int v = std::min((int)(((float)y + 0.5f - gy) / glyphSize * (float)cellHeight), cellHeight - 1);
+            const uint8_t* maskRow = r->fontMask + (c.texOffset[1] * cellHeight + v) * r->fontWidth + c.texOffset[0] * cellWidth;
+            Rgba8* row = r->pixels + y * r->width;
+            for (int x = px0; x < px1; ++x)
+            {
+                int u = std::min((int)(((float)x + 0.5f - gx) / glyphSize * (float)cellWidth), cellWidth - 1);
+                if (maskRow[u])
+                {
+                    row[x] = c.color;
+                }
+            }
+        }
+    }
+}
+
+static void drawTile(SoftRenderer* r, int tile)
+{
+    int tx = tile % r->tilesX;
+    int ty = tile / r->tilesX;
+    int x0 = tx * softTileSize;
+    int y0 = ty * softTileSize;
+    int x1 = std::min(x0 + softTileSize, r->width);
+    int y1 = std::min(y0 + softTileSize, r->height);
+
+    // Same as the GL clear color
+    const Rgba8 clearColor = packColor({ 0.1f, 0.1f, 0.1f });
+    for (int y = y0; y < y1; ++y)
+    {
+        Rgba8* row = r->pixels + y * r->width;
+        for (int x = x0; x < x1; ++x)
+        {
+            row[x] = clearColor;
+        }
+    }
+
+    for (int i = r->binStarts[tile]; i < r->binStarts[tile + 1]; ++i)
+    {
+        drawSegment(r, r->segments[r->binSegments[i]], x0, y0, x1, y1);
+    }
+
+    drawGlyphs(r, x0, y0, x1, y1);
+}
+
+static void drawTiles(SoftRenderer* r)
+{
+    TRACE_SCOPE("draw tiles");
+    int numTiles = r->tilesX * r->tilesY;
+    for (;;)
+    {
+        int tile = r->nextTile.fetch_add(1);
+        if (tile >= numTiles)
+        {
+            break;
+        }
+        drawTile(r, tile);
+    }
+}
+
+static void softWorker(SoftRenderer* r)
+{
+    setTraceThreadName("raster");
+    int generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(r->mutex);
+            r->cond.wait(lock, [r, generation] { return r->frameGeneration != generation || r->isStopping; });
+            if (r->isStopping)
+            {
+                return;
+            }
+            generation = r->frameGeneration;
+        }
+
+        drawTiles(r);
+
+        {
+            std::lock_guard<std::mutex> lock(r->mutex);
+            --r->numBusyWorkers;
+        }
+        r->doneCond.notify_one();
+    }
+}
+
+bool initSoftRenderer(SoftRenderer* r, int width, int height, int numThreads)
+{
+    if (width < 1 || width > softSizeMax || height < 1 || height > softSizeMax)
+    {
+        fprintf(stderr, "The software renderer can't draw %dx%d frames, at most %dx%d\n", width, height,
+            softSizeMax, softSizeMax);
+        return false;
+    }
+    r->width = width;
+    r->height = height;
+    r->tilesX = (width + softTileSize - 1) / softTileSize;
+    r->tilesY = (height + softTileSize - 1) / softTileSize;
+
+    stbi_set_flip_vertically_on_load_thread(true);
+    int numChannels;
+    unsigned char* data = stbi_load("MyFont.png", &r->fontWidth, &r->fontHeight, &numChannels, 4);
+    if (!data)
+    {
+        fprintf(stderr, "Failed to load texture\n");
+        exit(1);
+    }
+    r->fontMask = (uint8_t*)malloc((size_t)r->fontWidth * (size_t)r->fontHeight);
+    for (int i = 0; i < r->fontWidth * r->fontHeight; ++i)
+    {
+        r->fontMask[i] = data[i * 4 + 3];
+    }
+    stbi_image_free(data);
+
+    DefaultVertex verts[numFlipperVerts];
+    makeFlipperVerts(verts);
+    for (int i = 0; i < numFlipperVerts; ++i)
+    {
+        r->flipperVerts[i] = unpackVertexPos(verts[i]);
+    }
+    DefaultVertex circleVerts[numCircleVerts];
+    makeCircleVerts(circleVerts);
+    for (int i = 0; i < numCircleVerts; ++i)
+    {
+        r->circleVerts[i] = unpackVertexPos(circleVerts[i]);
+    }
+    DefaultVertex plungerVerts[numPlungerVerts];
+    makePlungerVerts(plungerVerts);
+    for (int i = 0; i < numPlungerVerts; ++i)
+    {
+        r->plungerVerts[i] = unpackVertexPos(plungerVerts[i]);
+    }
+
+    r->binStarts = (int*)malloc((size_t)(r->tilesX * r->tilesY + 1) * sizeof(int));
+    r->binSegmentsCap = softFixedSegmentsCap * 4;
+    r->binSegments = (int*)malloc((size_t)r->binSegmentsCap * sizeof(int));
+    r->segments = nullptr;
+    r->segmentsCap = 0;
+
+    if (numThreads <= 0)
+    {
+        numThreads = (int)std::thread::hardware_concurrency();
+    }
+    r->numWorkers = std::min(std::max(numThreads - 1, 0), softWorkersCap);
+    r->frameGeneration = 0;
+    r->numBusyWorkers = 0;
+    r->isStopping = false;
+    for (int i = 0; i < r->numWorkers; ++i)
+    {
+        r->workers[i] = std::thread(softWorker, r);
+    }
+    return true;
+}
+
+void softRender(SoftRenderer* r, RenderData* rd, Rgba8* pixels)
+{
+    r->rd = rd;
+    r->pixels = pixels;
+    r->numSegments = 0;
+
+    int numSegments = softFixedSegmentsCap + (rd->numStaticLineVerts + rd->numMirroredLineVerts + rd->numLineVerts) / 2;
+    if (numSegments > r->segmentsCap)
+    {
+        r->segmentsCap = numSegments;
+        r->segments = (SoftSegment*)realloc(r->segments, (size_t)r->segmentsCap * sizeof(SoftSegment));
+    }
+
+    // Same draws as render()
+    for (int i = 0; i < numCircles; ++i)
+    {
+        Circle c = rd->circles[i];
+        Mat3 m = I3;
+        m.m[0][0] = c.r;
+        m.m[1][1] = c.r;
+        m.m[2][0] = c.p.x;
+        m.m[2][1] = c.p.y;
+        addLineStrip(r, r->circleVerts, numCircleVerts, true, m, packColor({ 1.0f, 1.0f, 1.0f }));
+    }
+
+    for (int i = 0; i < numFlippers; ++i)
+    {
+        addLineStrip(r, r->flipperVerts, numFlipperVerts, true, rd->flipperTransforms[i], packColor({ 1.0f, 1.0f, 1.0f }));
+    }
+
+    Mat3 reflection = I3;
+    reflection.m[0][0] = -1.0f;
+    addLines(r, rd->staticLineVerts, rd->numStaticLineVerts, I3);
+    addLines(r, rd->staticLineVerts, rd->numMirroredLineVerts, reflection);
+
+    addLines(r, rd->lineVerts, rd->numLineVerts, I3);
+
+    for (int i = 0; i < rd->numDitchLids; ++i)
+    {
+        addSegment(r, rd->ditchLids[i].p0, rd->ditchLids[i].p1, packColor(defCol));
+    }
+
+    {
+        Mat3 m = I3;
+        m.m[1][1] = rd->plungerScaleY;
+        m.m[2][0] = rd->plungerCenterX;
+        addLineStrip(r, r->plungerVerts, numPlungerVerts, false, m, packColor(defCol));
+    }
+
+    addLines(r, rd->debugVerts, rd->numDebugVerts, I3);
+
+    if (rd->isTextDirty)
+    {
+        layoutText(rd);
+    }
+
+    binSegments(r);
+
+    r->nextTile = 0;
+    {
+        std::lock_guard<std::mutex> lock(r->mutex);
+        ++r->frameGeneration;
+        r->numBusyWorkers = r->numWorkers;
+    }
+    r->cond.notify_all();
+
+    drawTiles(r);
+
+    std::unique_lock<std::mutex> lock(r->mutex);
+    r->doneCond.wait(lock, [r] { return r->numBusyWorkers == 0; });
+}
+
+void freeSoftRenderer(SoftRenderer* r)
+{
+    {
+        std::lock_guard<std::mutex> lock(r->mutex);
+        r->isStopping = true;
+    }
+    r->cond.notify_all();
+    for (int i = 0; i < r->numWorkers; ++i)
+    {
+        r->workers[i].join();
+    }
+
+    free(r->fontMask);
+    free(r->binStarts);
+    free(r->binSegments);
+    free(r->segments);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "game.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Draws RenderData on the CPU, without an OpenGL context. The scene is lines and bitmap text, so every
+// frame is turned into a list of pixel space segments, binned into tiles, and the tiles are rasterized
+// in parallel. The output matches glReadPixels: RGBA, rows bottom to top.
+
+constexpr int softTileSize = 64;
+// Largest width and height, the tile binning works in a fixed size buffer
+constexpr int softSizeMax = 4096;
+constexpr int softWorkersCap = 16;
+
+// Lines drawn on every table, the rest depends on the size of the table
+constexpr int softFixedSegmentsCap =
+    numCircles * numCircleVerts + numFlippers * numFlipperVerts + numPlungerVerts + ditchLidsCap + debugVertsCap / 2;
+
+struct SoftSegment
+{
+    Vec2 p0;
+    Vec2 p1;
+    Rgba8 color;
+};
+
+struct SoftRenderer
+{
+    int width;
+    int height;
+    int tilesX;
+    int tilesY;
+
+    // Alpha of MyFont.png, rows bottom to top
+    uint8_t* fontMask;
+    int fontWidth;
+    int fontHeight;
+
+    Vec2 circleVerts[numCircleVerts];
+    Vec2 flipperVerts[numFlipperVerts];
+    Vec2 plungerVerts[numPlungerVerts];
+
+    // Per frame, grown to fit the table
+    SoftSegment* segments;
+    int numSegments;
+    int segmentsCap;
+    const RenderData* rd;
+    Rgba8* pixels;
+
+    // Segment indices sorted by tile, tile i has binSegments[binStarts[i]..binStarts[i + 1])
+    int* binStarts;
+    int* binSegments;
+    int binSegmentsCap;
+
+    // The calling thread draws tiles too
+    std::thread workers[softWorkersCap];
+    int numWorkers;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable doneCond;
+    int frameGeneration;
+    int numBusyWorkers;
+    bool isStopping;
+    std::atomic<int> nextTile;
+};
+
+// numThreads 0 uses every core. Returns false if the width or height is outside 1..softSizeMax. Loads
+// MyFont.png, exits on failure like the GL renderer.
+bool initSoftRenderer(SoftRenderer* r, int width, int height, int numThreads);
+
+// pixels holds width * height values
+void softRender(SoftRenderer* r, RenderData* rd, Rgba8* pixels);
+
+void freeSoftRenderer(SoftRenderer* r);
@@ -0,0 +1,594 @@
+// Runs the game and draws it with the CPU rasterizer (see softraster.h), no OpenGL involved.
+// Meant for thumbnails and low resolution frames on machines without a GPU stack. With --observe it
+// steps a batch of games and renders their training observations instead (see observation.h). With
+// --check it plays games on one thread and then on many at once, and checks that they come out the same.
+// With --heatmap it plays many games on every core and maps where the ball went (see heatmap.h).
+
+#include "autoplay.h"
+#include "game.h"
+#include "heatmap.h"
+#include "observation.h"
+#include "recorder.h"
+#include "softraster.h"
+#include "tablefile.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <thread>
+
+struct SoftwareOptions
+{
+    int numFrames;
+    int size;
+    const char* outDir;
+    const char* recordFilename;
+    int writeEvery;
+    unsigned int seed;
+    const char* tableFilename;
+    float frameDt;
+    int numThreads;
+    int numObservedGames;
+    int numCheckedGames;
+    int numHeatmapGames;
+    const char* traceFilename;
+};
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: my_pinball_software [options]\n"
+        "  --frames N   number of frames to run (default 600)\n"
+        "  --size N     width and height of the frames in pixels (default 200, at most 4096)\n"
+        "  --out DIR    write frames to DIR/frame_NNNNN.ppm\n"
+        "  --record F   record frames to F, an animated .gif or a .y4m video\n"
+        "  --every N    write every Nth frame (default 1)\n"
+        "  --seed N     random seed (default 1)\n"
+        "  --table F    load the table from F, a text or baked table (see tablefile.h)\n"
+        "  --fps N      simulated frame rate (default 60)\n"
+        "  --threads N  rasterizer threads, 0 for every core (default 0)\n"
+        "  --observe N  step N games and render their observations at --size (84 if not given),\n"
+        "               --out writes the first game's observations as PGM\n"
+        "  --check N    play and render N games at --size (64 if not given) on one thread, then\n"
+        "               on --threads threads at once, and exit with 1 if any game differs\n"
+        "  --heatmap N  play N games of --frames frames on --threads threads, write heatmap.bin and\n"
+        "               the table at --size (512 if not given) under the ball's occupancy and its\n"
+        "               contacts, heatmap_occupancy.png and heatmap_contacts.png, to --out or .\n"
+        "  --trace F    write a Chrome trace of the last frames to F\n");
+}
+
+static bool parseOptions(int argc, char** argv, SoftwareOptions* opts)
+{
+    *opts = {};
+    opts->numFrames = 600;
+    opts->size = 0;
+    opts->writeEvery = 1;
+    opts->seed = 1;
+    opts->frameDt = 1.0f / 60.0f;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            return false;
+        }
+        ++i;
+
+        if (strcmp(arg, "--frames") == 0)
+        {
+            opts->numFrames = atoi(value);
+        }
+        else if (strcmp(arg, "--size") == 0)
+        {
+            opts->size = atoi(value);
+        }
+        else if (strcmp(arg, "--out") == 0)
+        {
+            opts->outDir = value;
+        }
+        else if (strcmp(arg, "--record") == 0)
+        {
+            opts->recordFilename = value;
+        }
+        else if (strcmp(arg, "--every") == 0)
+        {
+            opts->writeEvery = atoi(value);
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            opts->seed = (unsigned int)strtoul(value, nullptr, 10);
+        }
+        else if (strcmp(arg, "--table") == 0)
+        {
+            opts->tableFilename = value;
+        }
+        else if (strcmp(arg, "--fps") == 0)
+        {
+            opts->frameDt = 1.0f / (float)atof(value);
+        }
+        else if (strcmp(arg, "--trace") == 0)
+        {
+            opts->traceFilename = value;
+        }
+        else if (strcmp(arg, "--threads") == 0)
+        {
+            opts->numThreads = atoi(value);
+        }
+        else if (strcmp(arg, "--observe") == 0)
+        {
+            opts->numObservedGames = atoi(value);
+        }
+        else if (strcmp(arg, "--check") == 0)
+        {
+            opts->numCheckedGames = atoi(value);
+        }
+        else if (strcmp(arg, "--heatmap") == 0)
+        {
+            opts->numHeatmapGames = atoi(value);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (opts->size == 0)
+    {
+        opts->size = opts->numObservedGames > 0 ? defaultObservationSize : opts->numCheckedGames > 0 ? 64 :
+            opts->numHeatmapGames > 0 ? 2 * heatmapSize : 200;
+    }
+
+    return opts->numFrames > 0 && opts->size > 0 && opts->size <= softSizeMax && opts->numObservedGames >= 0 && opts->numCheckedGames >= 0 && opts->numHeatmapGames >= 0 && opts->writeEvery > 0 &&
+        opts->frameDt > 0.0f && opts->numThreads >= 0;
+}
+
+static double getSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static bool writePgm(const char* filename, const uint8_t* pixels, int width, int height)
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+    fprintf(file, "P5\n%d %d\n255\n", width, height);
+    fwrite(pixels, 1, (size_t)width * (size_t)height, file);
+    fclose(file);
+    return true;
+}
+
+static int runObservations(const SoftwareOptions& opts)
+{
+    Table table;
+    if (!initTable(&table, opts.tableFilename))
+    {
+        return 1;
+    }
+
+    int numGames = opts.numObservedGames;
+    Game* games = (Game*)malloc((size_t)numGames * sizeof(Game));
+    for (int i = 0; i < numGames; ++i)
+    {
+        initGame(&games[i], &table, opts.seed + (unsigned int)i);
+    }
+
+    ObservationRenderer obs;
+    initObservationRenderer(&obs, &table, opts.size, opts.size);
+    float* features = (float*)malloc((size_t)numGames * numObservationFeatures * sizeof(float));
+    uint8_t* images = (uint8_t*)malloc((size_t)numGames * (size_t)opts.size * (size_t)opts.size);
+
+    double observeTime = 0.0;
+    double startTime = getSeconds();
+
+    for (int frameIndex = 0; frameIndex < opts.numFrames; ++frameIndex)
+    {
+        for (int i = 0; i < numGames; ++i)
+        {
+            // Offset the autoplayer so the games drift apart
+            updateGame(&games[i], getAutoplayInput(&games[i], frameIndex + i), opts.frameDt);
+        }
+
+        double observeStart = getSeconds();
+        getObservationFeatures(games, numGames, features);
+        renderObservations(&obs, games, numGames, images);
+        observeTime += getSeconds() - observeStart;
+
+        if (opts.outDir && frameIndex % opts.writeEvery == 0)
+        {
+            char filename[1024];
+            snprintf(filename, sizeof filename, "%s/obs_%05d.pgm", opts.outDir, frameIndex);
+            if (!writePgm(filename, images, opts.size, opts.size))
+            {
+                return 1;
+            }
+        }
+    }
+
+    double elapsed = getSeconds() - startTime;
+    double numSteps = (double)opts.numFrames * numGames;
+    printf("%d games x %d frames in %.3f s, %.0f steps/s, %.3f us per observation\n",
+        numGames, opts.numFrames, elapsed, numSteps / elapsed, observeTime * 1e6 / numSteps);
+    printf("Game 0 features:");
+    for (int i = 0; i < numObservationFeatures; ++i)
+    {
+        printf(" %.3f", features[i]);
+    }
+    printf("\n");
+
+    free(images);
+    free(features);
+    freeObservationRenderer(&obs);
+    free(games);
+    freeTable(&table);
+
+    return 0;
+}
+
+constexpr int checkThreadsCap = 64;
+
+// What a checked game has been through, compared between the single threaded and threaded runs
+struct GameDigest
+{
+    uint32_t stateHash;
+    uint32_t imageHash;
+    int score;
+};
+
+// FNV-1a, continuing from hash
+static uint32_t hashBytes(uint32_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Plays games first, first + stride, ... with a game, render data and renderer of its own.
+// Nothing is shared with other threads but the table.
+static bool playCheckedGames(const SoftwareOptions* opts, const Table* table, int first, int stride, GameDigest* digests)
+{
+    SoftRenderer softRenderer;
+    if (!initSoftRenderer(&softRenderer, opts->size, opts->size, 1))
+    {
+        return false;
+    }
+    RenderData* rd = (RenderData*)malloc(sizeof(RenderData));
+    Rgba8* pixels = (Rgba8*)malloc((size_t)opts->size * (size_t)opts->size * sizeof(Rgba8));
+    size_t imageSize = (size_t)opts->size * (size_t)opts->size * sizeof(Rgba8);
+
+    for (int i = first; i < opts->numCheckedGames; i += stride)
+    {
+        Game game;
+        initGame(&game, table, opts->seed + (unsigned int)i);
+        Hud hud;
+        initRenderData(rd, &hud, table);
+
+        GameDigest digest = { 2166136261u, 2166136261u, 0 };
+        for (int frameIndex = 0; frameIndex < opts->numFrames; ++frameIndex)
+        {
+            updateGame(&game, getAutoplayInput(&game, frameIndex + i), opts->frameDt);
+
+            float features[numObservationFeatures];
+            getObservationFeatures(&game, 1, features);
+            digest.stateHash = hashBytes(digest.stateHash, features, sizeof features);
+            digest.stateHash = hashBytes(digest.stateHash, &game.score, sizeof game.score);
+
+            fillRenderData(rd, &hud, &game);
+            softRender(&softRenderer, rd, pixels);
+            digest.imageHash = hashBytes(digest.imageHash, pixels, imageSize);
+        }
+        digest.score = game.score;
+        digests[i] = digest;
+        freeRenderData(rd);
+    }
+
+    free(pixels);
+    freeSoftRenderer(&softRenderer);
+    free(rd);
+    return true;
+}
+
+static int runCheck(const SoftwareOptions& opts)
+{
+    Table table;
+    if (!initTable(&table, opts.tableFilename))
+    {
+        return 1;
+    }
+
+    int numGames = opts.numCheckedGames;
+    int numThreads = opts.numThreads > 0 ? opts.numThreads : (int)std::thread::hardware_concurrency();
+    numThreads = std::min(std::max(numThreads, 1), std::min(numGames, checkThreadsCap));
+
+    GameDigest* expected = (GameDigest*)malloc((size_t)numGames * sizeof(GameDigest));
+    GameDigest* actual = (GameDigest*)malloc((size_t)numGames * sizeof(GameDigest));
+
+    double startTime = getSeconds();
+    // The threads can't fail if this doesn't
+    if (!playCheckedGames(&opts, &table, 0, 1, expected))
+    {
+        return 1;
+    }
+    double singleTime = getSeconds() - startTime;
+
+    startTime = getSeconds();
+    std::thread threads[checkThreadsCap];
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads[i] = std::thread(playCheckedGames, &opts, &table, i, numThreads, actual);
+    }
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads[i].join();
+    }
+    double threadedTime = getSeconds() - startTime;
+
+    int numMismatches = 0;
+    for (int i = 0; i < numGames; ++i)
+    {
+        if (memcmp(&expected[i], &actual[i], sizeof(GameDigest)) != 0)
+        {
+            fprintf(stderr, "Game %d differs: state %08x vs %08x, image %08x vs %08x, score %d vs %d\n", i,
+                expected[i].stateHash, actual[i].stateHash, expected[i].imageHash, actual[i].imageHash,
+                expected[i].score, actual[i].score);
+            ++numMismatches;
+        }
+    }
+
+    printf("%d games x %d frames: %.3f s on 1 thread, %.3f s on %d threads, %d differ\n",
+        numGames, opts.numFrames, singleTime, threadedTime, numThreads, numMismatches);
+
+    free(actual);
+    free(expected);
+    freeTable(&table);
+
+    return numMismatches == 0 ? 0 : 1;
+}
+
+// Plays games first, first + stride, ... counting their ticks into a heatmap of the thread's own
+static void playHeatmapGames(const SoftwareOptions* opts, const Table* table, int first, int stride, Heatmap* heatmap)
+{
+    for (int i = first; i < opts->numHeatmapGames; i += stride)
+    {
+        Game game;
+        initGame(&game, table, opts->seed + (unsigned int)i);
+        game.tickCallback = countHeatmapTick;
+        game.tickCallbackUser = heatmap;
+        for (int frameIndex = 0; frameIndex < opts->numFrames; ++frameIndex)
+        {
+            updateGame(&game, getAutoplayInput(&game, frameIndex + i), opts->frameDt);
+        }
+    }
+}
+
+static int runHeatmap(const SoftwareOptions& opts)
+{
+    Table table;
+    if (!initTable(&table, opts.tableFilename))
+    {
+        return 1;
+    }
+
+    int numGames = opts.numHeatmapGames;
+    int numThreads = opts.numThreads > 0 ? opts.numThreads : (int)std::thread::hardware_concurrency();
+    numThreads = std::min(std::max(numThreads, 1), std::min(numGames, checkThreadsCap));
+
+    Heatmap heatmaps[checkThreadsCap];
+    for (int i = 0; i < numThreads; ++i)
+    {
+        if (!initHeatmap(&heatmaps[i]))
+        {
+            for (int j = 0; j < i; ++j)
+            {
+                freeHeatmap(&heatmaps[j]);
+            }
+            freeTable(&table);
+            return 1;
+        }
+    }
+
+    std::thread threads[checkThreadsCap];
+    double startTime = getSeconds();
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads[i] = std::thread(playHeatmapGames, &opts, &table, i, numThreads, &heatmaps[i]);
+    }
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads[i].join();
+    }
+    for (int i = 1; i < numThreads; ++i)
+    {
+        mergeHeatmap(&heatmaps[0], &heatmaps[i]);
+        freeHeatmap(&heatmaps[i]);
+    }
+    double elapsed = getSeconds() - startTime;
+    const Heatmap* heatmap = &heatmaps[0];
+    printf("%d games x %d frames on %d threads in %.3f s, %.0f ticks/s, %llu contacts\n", numGames, opts.numFrames,
+        numThreads, elapsed, (double)heatmap->numTicks / elapsed, (unsigned long long)heatmap->numContacts);
+
+    const char* outDir = opts.outDir ? opts.outDir : ".";
+    char filename[1024];
+    snprintf(filename, sizeof filename, "%s/heatmap.bin", outDir);
+    bool isOk = writeHeatmap(heatmap, filename);
+
+    // The table as a game starts, under each grid
+    Game game;
+    initGame(&game, &table, opts.seed);
+    RenderData* rd = (RenderData*)malloc(sizeof(RenderData));
+    Hud hud;
+    initRenderData(rd, &hud, &table);
+    fillRenderData(rd, &hud, &game);
+    SoftRenderer softRenderer;
+    if (!initSoftRenderer(&softRenderer, opts.size, opts.size, opts.numThreads))
+    {
+        return 1;
+    }
+    size_t imageSize = (size_t)opts.size * (size_t)opts.size * sizeof(Rgba8);
+    Rgba8* tablePixels = (Rgba8*)malloc(imageSize);
+    Rgba8* pixels = (Rgba8*)malloc(imageSize);
+    softRender(&softRenderer, rd, tablePixels);
+
+    const uint64_t* grids[2] = { heatmap->occupancy, heatmap->contacts };
+    const char* names[2] = { "occupancy", "contacts" };
+    for (int i = 0; i < 2 && isOk; ++i)
+    {
+        memcpy(pixels, tablePixels, imageSize);
+        drawHeatmap(grids[i], (unsigned char*)pixels, opts.size, opts.size);
+        snprintf(filename, sizeof filename, "%s/heatmap_%s.png", outDir, names[i]);
+        isOk = writePng(filename, (const unsigned char*)pixels, opts.size, opts.size);
+    }
+
+    free(pixels);
+    free(tablePixels);
+    freeSoftRenderer(&softRenderer);
+    freeRenderData(rd);
+    free(rd);
+    freeHeatmap(&heatmaps[0]);
+    freeTable(&table);
+
+    return isOk ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+
+    SoftwareOptions opts;
+    if (!parseOptions(argc, argv, &opts))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (opts.numObservedGames > 0)
+    {
+        return runObservations(opts);
+    }
+    if (opts.numCheckedGames > 0)
+    {
+        return runCheck(opts);
+    }
+    if (opts.numHeatmapGames > 0)
+    {
+        return runHeatmap(opts);
+    }
+
+    Table table;
+    if (!initTable(&table, opts.tableFilename))
+    {
+        return 1;
+    }
+
+    if (opts.traceFilename)
+    {
+        initTracing();
+        setTraceThreadName("main");
+    }
+
+    Game game;
+    initGame(&game, &table, opts.seed);
+
+    RenderData* rd = (RenderData*)malloc(sizeof(RenderData));
+    Hud hud;
+    initRenderData(rd, &hud, &table);
+
+    SoftRenderer softRenderer;
+    if (!initSoftRenderer(&softRenderer, opts.size, opts.size, opts.numThreads))
+    {
+        return 1;
+    }
+    Rgba8* pixels = (Rgba8*)malloc((size_t)opts.size * (size_t)opts.size * sizeof(Rgba8));
+
+    Recorder recorder;
+    if (opts.recordFilename)
+    {
+        float recordFps = 1.0f / (opts.frameDt * (float)opts.writeEvery);
+        if (!initRecorder(&recorder, opts.recordFilename, opts.size, opts.size, recordFps))
+        {
+            return 1;
+        }
+    }
+
+    int numWrittenFrames = 0;
+    double renderTime = 0.0;
+    double startTime = getSeconds();
+
+    for (int frameIndex = 0; frameIndex < opts.numFrames; ++frameIndex)
+    {
+        TRACE_SCOPE("frame");
+        GameInput input = getAutoplayInput(&game, frameIndex);
+        {
+            TRACE_SCOPE("physics");
+            updateGame(&game, input, opts.frameDt);
+        }
+
+        {
+            TRACE_SCOPE("vertices");
+            fillRenderData(rd, &hud, &game);
+        }
+
+        double renderStart = getSeconds();
+        {
+            TRACE_SCOPE("raster");
+            softRender(&softRenderer, rd, pixels);
+        }
+        renderTime += getSeconds() - renderStart;
+
+        if (frameIndex % opts.writeEvery == 0 && (opts.outDir || opts.recordFilename))
+        {
+            const unsigned char* rgba = (const unsigned char*)pixels;
+            if (opts.outDir)
+            {
+                char filename[1024];
+                snprintf(filename, sizeof filename, "%s/frame_%05d.ppm", opts.outDir, frameIndex);
+                if (!writePpm(filename, rgba, opts.size, opts.size))
+                {
+                    return 1;
+                }
+            }
+            if (opts.recordFilename)
+            {
+                recordFrame(&recorder, rgba, frameIndex / opts.writeEvery);
+            }
+            ++numWrittenFrames;
+        }
+    }
+
+    if (opts.recordFilename)
+    {
+        finishRecorder(&recorder);
+    }
+    double elapsed = getSeconds() - startTime;
+
+    printf("%d frames (%d written) in %.3f s, %.1f frames/s, %.3f ms per rasterized frame, score %d\n",
+        opts.numFrames, numWrittenFrames, elapsed, opts.numFrames / elapsed, renderTime * 1000.0 / opts.numFrames, game.score);
+
+    free(pixels);
+    freeSoftRenderer(&softRenderer);
+    freeRenderData(rd);
+    free(rd);
+    freeTable(&table);
+
+    if (opts.traceFilename)
+    {
+        writeTrace(opts.traceFilename);
+        freeTracing();
+    }
+
+    return 0;
+}
@@ -0,0 +1,226 @@
+// Plays generated tables of growing size (see tablegen.h) and measures how the simulation and the
+// drawing scale with the number of primitives: fixed-step ticks per second, filling the per-frame
+// render data, and rasterizing a frame with the CPU software rasterizer (not the GL renderer).
+// A single game's cost depends on where its ball goes (a ball lying in the drain is cheap), so the
+// ticks are timed over several games with different seeds and printed as mean, min and max.
+
+#include "autoplay.h"
+#include "game.h"
+#include "softraster.h"
+#include "tablegen.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+constexpr int stressCountsCap = 32;
+
+struct StressOptions
+{
+    int counts[stressCountsCap];
+    int numCounts;
+    int numTicks;
+    int numGames;
+    int numFrames;
+    int size;
+    int numThreads;
+    unsigned int seed;
+};
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: my_pinball_stress [options]\n"
+        "  --counts N,N,...  primitives added to the built-in table (default 1000,3000,10000,30000,100000)\n"
+        "  --ticks N         simulation ticks to time per game (default 1200)\n"
+        "  --games N         games with seeds from --seed up to time per table (default 5)\n"
+        "  --frames N        frames to draw with the CPU rasterizer per table (default 10)\n"
+        "  --size N          width and height of the frames in pixels (default 400)\n"
+        "  --threads N       rasterizer threads, 0 for every core (default 1)\n"
+        "  --seed N          random seed of the tables and the games (default 1)\n");
+}
+
+static bool parseCounts(const char* str, StressOptions* opts)
+{
+    opts->numCounts = 0;
+    const char* ptr = str;
+    for (;;)
+    {
+        char* end;
+        long count = strtol(ptr, &end, 10);
+        if (end == ptr || count < 0 || count > 10000000 || opts->numCounts == stressCountsCap)
+        {
+            return false;
+        }
+        opts->counts[opts->numCounts++] = (int)count;
+        if (*end == '\0')
+        {
+            return true;
+        }
+        if (*end != ',')
+        {
+            return false;
+        }
+        ptr = end + 1;
+    }
+}
+
+static bool parseOptions(int argc, char** argv, StressOptions* opts)
+{
+    *opts = {};
+    parseCounts("1000,3000,10000,30000,100000", opts);
+    opts->numTicks = 1200;
+    opts->numGames = 5;
+    opts->numFrames = 10;
+    opts->size = 400;
+    opts->numThreads = 1;
+    opts->seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            return false;
+        }
+        ++i;
+
+        if (strcmp(arg, "--counts") == 0)
+        {
+            if (!parseCounts(value, opts))
+            {
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--ticks") == 0)
+        {
+            opts->numTicks = atoi(value);
+        }
+        else if (strcmp(arg, "--games") == 0)
+        {
+            opts->numGames = atoi(value);
+        }
+        else if (strcmp(arg, "--frames") == 0)
+        {
+            opts->numFrames = atoi(value);
+        }
+        else if (strcmp(arg, "--size") == 0)
+        {
+            opts->size = atoi(value);
+        }
+        else if (strcmp(arg, "--threads") == 0)
+        {
+            opts->numThreads = atoi(value);
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            opts->seed = (unsigned int)strtoul(value, nullptr, 10);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return opts->numTicks > 0 && opts->numGames > 0 && opts->numFrames > 0 && opts->size > 0 && opts->size <= softSizeMax && opts->numThreads >= 0;
+}
+
+static double getSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+    StressOptions opts;
+    if (!parseOptions(argc, argv, &opts))
+    {
+        printUsage();
+        return 1;
+    }
+
+    SoftRenderer softRenderer;
+    if (!initSoftRenderer(&softRenderer, opts.size, opts.size, opts.numThreads))
+    {
+        return 1;
+    }
+    Rgba8* pixels = (Rgba8*)malloc((size_t)opts.size * (size_t)opts.size * sizeof(Rgba8));
+    RenderData* rd = (RenderData*)malloc(sizeof(RenderData));
+
+    printf("%10s %12s %12s %12s %10s %10s %10s %12s %14s\n",
+        "primitives", "static verts", "line verts", "ticks/s", "us/tick", "min", "max", "cpu fill ms", "cpu raster ms");
+
+    for (int countIndex = 0; countIndex < opts.numCounts; ++countIndex)
+    {
+        Table table;
+        if (!generateTable(&table, opts.counts[countIndex], opts.seed))
+        {
+            return 1;
+        }
+
+        // The ticks the game would run at 60 frames per second, so the autoplayer sees the same frames
+        Game game;
+        double tickTimeSum = 0.0;
+        double tickTimeMin = 0.0;
+        double tickTimeMax = 0.0;
+        for (int gameIndex = 0; gameIndex < opts.numGames; ++gameIndex)
+        {
+            initGame(&game, &table, opts.seed + (unsigned int)gameIndex);
+            double startTime = getSeconds();
+            for (int tick = 0; tick < opts.numTicks; ++tick)
+            {
+                updateGame(&game, getAutoplayInput(&game, tick / 2), simDt);
+            }
+            double tickTime = getSeconds() - startTime;
+
+            tickTimeSum += tickTime;
+            if (gameIndex == 0 || tickTime < tickTimeMin)
+            {
+                tickTimeMin = tickTime;
+            }
+            if (gameIndex == 0 || tickTime > tickTimeMax)
+            {
+                tickTimeMax = tickTime;
+            }
+        }
+        double tickTime = tickTimeSum / opts.numGames;
+
+        Hud hud;
+        initRenderData(rd, &hud, &table);
+        double fillTime = 0.0;
+        double rasterTime = 0.0;
+        for (int frameIndex = 0; frameIndex < opts.numFrames; ++frameIndex)
+        {
+            updateGame(&game, getAutoplayInput(&game, opts.numTicks / 2 + frameIndex), 2.0f * simDt);
+
+            double fillStart = getSeconds();
+            fillRenderData(rd, &hud, &game);
+            double rasterStart = getSeconds();
+            softRender(&softRenderer, rd, pixels);
+            double rasterEnd = getSeconds();
+
+            fillTime += rasterStart - fillStart;
+            rasterTime += rasterEnd - rasterStart;
+        }
+
+        // The frames continue the last game
+        printf("%10d %12d %12d %12.0f %10.2f %10.2f %10.2f %12.3f %14.3f\n",
+            opts.counts[countIndex], rd->numStaticLineVerts, rd->numLineVerts, opts.numTicks / tickTime,
+            tickTime * 1e6 / opts.numTicks, tickTimeMin * 1e6 / opts.numTicks, tickTimeMax * 1e6 / opts.numTicks,
+            fillTime * 1000.0 / opts.numFrames, rasterTime * 1000.0 / opts.numFrames);
+        fflush(stdout);
+
+        freeRenderData(rd);
+        freeTable(&table);
+    }
+
+    free(rd);
+    free(pixels);
+    freeSoftRenderer(&softRenderer);
+
+    return 0;
+}
@@ -0,0 +1,952 @@
+#include "tablefile.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+constexpr int tableLineCap = 256;
+constexpr int tableArgsCap = 8;
+constexpr int arcStepsMax = 64;
+constexpr int tableScoreMax = 1000000;
+// The built-in bumpers are 4 to 5
+constexpr float tableBouncinessMax = 20.0f;
+
+struct TableLine
+{
+    const char* filename;
+    int number;
+    char keyword[32];
+    // The word after bounciness and score
+    char material[32];
+    float args[tableArgsCap];
+    int numArgs;
+};
+
+static bool lineError(const TableLine* line, const char* message)
+{
+    fprintf(stderr, "%s:%d: %s: %s\n", line->filename, line->number, line->keyword, message);
+    return false;
+}
+
+static bool checkArgs(const TableLine* line, int numArgs)
+{
+    if (line->numArgs != numArgs)
+    {
+        char message[64];
+        snprintf(message, sizeof message, "expected %d numbers, got %d", numArgs, line->numArgs);
+        return lineError(line, message);
+    }
+    return true;
+}
+
+// Reserves the next element of an array in the table, cap is what the first pass counted
+static bool addPrimitive(const TableLine* line, int numArgs, int* count, int cap)
+{
+    if (!checkArgs(line, numArgs))
+    {
+        return false;
+    }
+    if (*count == cap)
+    {
+        return lineError(line, "too many on one table");
+    }
+    ++*count;
+    return true;
+}
+
+// Checked before the cast, a float out of the range of int doesn't convert to anything
+static bool isWholeNumber(float x, int min, int max)
+{
+    return x >= (float)min && x <= (float)max && floorf(x) == x;
+}
+
+static bool isBouncinessValid(float x)
+{
+    return x >= 0.0f && x <= tableBouncinessMax;
+}
+
+// False for NaN and infinities too
+static bool isCoordInRange(float x)
+{
+    return fabsf(x) <= tableCoordMax;
+}
+
+static bool isArcInRange(const Arc& arc)
+{
+    return isCoordInRange(fabsf(arc.p.x) + arc.r) && isCoordInRange(fabsf(arc.p.y) + arc.r);
+}
+
+// Written so that NaN fails them
+static bool isArcValid(const Arc& arc)
+{
+    return arc.r > 0.0f && arc.start >= 0.0f && arc.start < twoPi && arc.end >= 0.0f && arc.end < twoPi;
+}
+
+static bool isNormalValid(Vec2 n)
+{
+    return fabsf(getLength(n) - 1.0f) <= 1e-3f;
+}
+
+static LineSegment getSegment(const float* args)
+{
+    return { { args[0], args[1] }, { args[2], args[3] } };
+}
+
+static bool getArc(const TableLine* line, Arc* arc, int* steps)
+{
+    const float* a = line->args;
+    *arc = { { a[0], a[1] }, a[2], a[3], a[4] };
+    if (!isArcValid(*arc))
+    {
+        return lineError(line, "the radius must be positive and the angles in [0, 2pi)");
+    }
+    if (!isArcInRange(*arc))
+    {
+        return lineError(line, "the arc must stay within 120 of the origin on both axes");
+    }
+    if (!isWholeNumber(a[5], 2, arcStepsMax))
+    {
+        return lineError(line, "the steps must be a whole number from 2 to 64");
+    }
+    *steps = (int)a[5];
+    return true;
+}
+
+// The first pass over the text, to allocate the table with room for every primitive
+static void countLine(TableSizes* sizes, const TableLine* line)
+{
+    const char* k = line->keyword;
+    if (strcmp(k, "wall") == 0) ++sizes->numBasicWalls;
+    else if (strcmp(k, "mirrored_wall") == 0) ++sizes->numMirroredWalls;
+    else if (strcmp(k, "slingshot") == 0) ++sizes->numSlingshotWalls;
+    else if (strcmp(k, "one_way_wall") == 0) ++sizes->numOneWayWalls;
+    else if (strcmp(k, "arc") == 0) ++sizes->numArcs;
+    else if (strcmp(k, "mirrored_arc") == 0) ++sizes->numMirroredArcs;
+    else if (strcmp(k, "capsule") == 0) ++sizes->numCapsules;
+    else if (strcmp(k, "pop_bumper") == 0) ++sizes->numPopBumpers;
+    else if (strcmp(k, "button") == 0) ++sizes->numButtons;
+    else if (strcmp(k, "ditch") == 0) ++sizes->numDitches;
+}
+
+static bool parseLine(Table* table, const TableSizes* sizes, const TableLine* line, bool* hasPlunger, bool* hasBall)
+{
+    const char* k = line->keyword;
+    const float* a = line->args;
+
+    // All the numbers are coordinates but those of materials, the radius and angles of arcs, checked with
+    // the arc, and the normals of buttons
+    int numCoords = line->numArgs;
+    if (strcmp(k, "bounciness") == 0 || strcmp(k, "score") == 0)
+    {
+        numCoords = 0;
+    }
+    else if (strcmp(k, "arc") == 0 || strcmp(k, "mirrored_arc") == 0 || strcmp(k, "button") == 0)
+    {
+        numCoords = numCoords < 2 ? numCoords : 2;
+    }
+    for (int i = 0; i < numCoords; ++i)
+    {
+        if (!isCoordInRange(a[i]))
+        {
+            return lineError(line, "the coordinates must be from -120 to 120");
+        }
+    }
+
+    if (strcmp(k, "wall") == 0)
+    {
+        if (!addPrimitive(line, 4, &table->numBasicWalls, sizes->numBasicWalls)) return false;
+        table->basicWalls[table->numBasicWalls - 1] = getSegment(a);
+    }
+    else if (strcmp(k, "mirrored_wall") == 0)
+    {
+        if (!addPrimitive(line, 4, &table->numMirroredWalls, sizes->numMirroredWalls)) return false;
+        table->mirroredWalls[table->numMirroredWalls - 1] = getSegment(a);
+        if (!canStoreMirrored(getSegment(a)))
+        {
+            return lineError(line, "must lie at x <= -1, or the ball could touch both copies, use two walls");
+        }
+    }
+    else if (strcmp(k, "slingshot") == 0)
+    {
+        if (!addPrimitive(line, 4, &table->numSlingshotWalls, sizes->numSlingshotWalls)) return false;
+        table->slingshotWalls[table->numSlingshotWalls - 1] = getSegment(a);
+    }
+    else if (strcmp(k, "one_way_wall") == 0)
+    {
+        if (!addPrimitive(line, 4, &table->numOneWayWalls, sizes->numOneWayWalls)) return false;
+        table->oneWayWalls[table->numOneWayWalls - 1] = getSegment(a);
+    }
+    else if (strcmp(k, "arc") == 0)
+    {
+        if (!addPrimitive(line, 6, &table->numArcs, sizes->numArcs)) return false;
+        int i = table->numArcs - 1;
+        if (!getArc(line, &table->arcs[i], &table->arcSteps[i])) return false;
+    }
+    else if (strcmp(k, "mirrored_arc") == 0)
+    {
+        if (!addPrimitive(line, 6, &table->numMirroredArcs, sizes->numMirroredArcs)) return false;
+        int i = table->numMirroredArcs - 1;
+        if (!getArc(line, &table->mirroredArcs[i], &table->mirroredArcSteps[i])) return false;
+        if (!canStoreMirrored(table->mirroredArcs[i]))
+        {
+            return lineError(line, "must lie at x <= -1, or the ball could touch both copies, use two arcs");
+        }
+    }
+    else if (strcmp(k, "capsule") == 0)
+    {
+        if (!addPrimitive(line, 2, &table->numCapsules, sizes->numCapsules)) return false;
+        table->capsules[table->numCapsules - 1] = { a[0], a[1] };
+    }
+    else if (strcmp(k, "pop_bumper") == 0)
+    {
+        if (!addPrimitive(line, 2, &table->numPopBumpers, sizes->numPopBumpers)) return false;
+        table->popBumpers[table->numPopBumpers - 1] = { a[0], a[1] };
+    }
+    else if (strcmp(k, "button") == 0)
+    {
+        if (!addPrimitive(line, 4, &table->numButtons, sizes->numButtons)) return false;
+        Vec2 n = { a[2], a[3] };
+        if (!isNormalValid(n))
+        {
+            return lineError(line, "the normal must have length 1");
+        }
+        table->buttons[table->numButtons - 1] = { { a[0], a[1] }, n };
+    }
+    else if (strcmp(k, "ditch") == 0)
+    {
+        if (!addPrimitive(line, 8, &table->numDitches, sizes->numDitches)) return false;
+        table->ditches[table->numDitches - 1] = { getSegment(a), getSegment(a + 4) };
+    }
+    else if (strcmp(k, "plunger") == 0)
+    {
+        if (!checkArgs(line, 3)) return false;
+        table->plungerLeftX = a[0];
+        table->plungerRightX = a[1];
+        table->plungerCenterX = (table->plungerLeftX + table->plungerRightX) / 2.0f;
+        table->plungerTopY = a[2];
+        *hasPlunger = true;
+    }
+    else if (strcmp(k, "ball") == 0)
+    {
+        if (!checkArgs(line, 2)) return false;
+        table->initialBallPosition = { a[0], a[1] };
+        *hasBall = true;
+    }
+    else if (strcmp(k, "bounciness") == 0 || strcmp(k, "score") == 0)
+    {
+        if (!checkArgs(line, 1)) return false;
+        bool isScore = k[0] == 's';
+        float* bounciness = nullptr;
+        int* score = nullptr;
+        if (strcmp(line->material, "slingshot") == 0)
+        {
+            bounciness = &table->slingshotBounciness;
+            score = &table->slingshotScore;
+        }
+        else if (strcmp(line->material, "pop_bumper") == 0)
+        {
+            bounciness = &table->popBumperBounciness;
+            score = &table->popBumperScore;
+        }
+        else if (strcmp(line->material, "button") == 0)
+        {
+            bounciness = &table->buttonBounciness;
+            score = &table->buttonScore;
+        }
+        else
+        {
+            return lineError(line, "expected slingshot, pop_bumper or button");
+        }
+        if (isScore)
+        {
+            if (!isWholeNumber(a[0], 0, tableScoreMax))
+            {
+                return lineError(line, "the score must be a whole number from 0 to 1000000");
+            }
+            *score = (int)a[0];
+        }
+        else
+        {
+            if (!isBouncinessValid(a[0]))
+            {
+                return lineError(line, "the bounciness must be from 0 to 20");
+            }
+            *bounciness = a[0];
+        }
+    }
+    else
+    {
+        return lineError(line, "unknown keyword");
+    }
+    return true;
+}
+
+// Splits the next line into the keyword and the numbers, the keyword is empty on blank lines
+static bool readLine(const char** next, TableLine* line)
+{
+    const char* end = strchr(*next, '\n');
+    if (!end)
+    {
+        end = *next + strlen(*next);
+    }
+
+    char buf[tableLineCap];
+    size_t len = (size_t)(end - *next);
+    if (len >= sizeof buf)
+    {
+        fprintf(stderr, "%s:%d: line too long\n", line->filename, line->number);
+        return false;
+    }
+    memcpy(buf, *next, len);
+    buf[len] = '\0';
+    *next = *end ? end + 1 : end;
+
+    char* comment = strchr(buf, '#');
+    if (comment)
+    {
+        *comment = '\0';
+    }
+
+    int n;
+    if (sscanf(buf, " %31s%n", line->keyword, &n) != 1)
+    {
+        return true;
+    }
+    const char* ptr = buf + n;
+    if (strcmp(line->keyword, "bounciness") == 0 || strcmp(line->keyword, "score") == 0)
+    {
+        if (sscanf(ptr, " %31s%n", line->material, &n) != 1)
+        {
+            return lineError(line, "expected slingshot, pop_bumper or button");
+        }
+        ptr += n;
+    }
+
+    for (;;)
+    {
+        while (isspace((unsigned char)*ptr))
+        {
+            ++ptr;
+        }
+        if (!*ptr)
+        {
+            break;
+        }
+        char* numberEnd;
+        float value = strtof(ptr, &numberEnd);
+        if (numberEnd == ptr)
+        {
+            return lineError(line, "expected a number");
+        }
+        if (line->numArgs == tableArgsCap)
+        {
+            return lineError(line, "too many numbers");
+        }
+        line->args[line->numArgs++] = value;
+        ptr = numberEnd;
+    }
+    return true;
+}
+
+// Counts the primitives into sizes when table is null, fills the table otherwise
+static bool readLines(Table* table, TableSizes* sizes, const char* text, const char* filename)
+{
+    bool hasPlunger = false;
+    bool hasBall = false;
+
+    const char* next = text;
+    for (int number = 1; *next; ++number)
+    {
+        TableLine line = {};
+        line.filename = filename;
+        line.number = number;
+        if (!readLine(&next, &line))
+        {
+            return false;
+        }
+        if (!line.keyword[0])
+        {
+            continue;
+        }
+        if (!table)
+        {
+            countLine(sizes, &line);
+        }
+        else if (!parseLine(table, sizes, &line, &hasPlunger, &hasBall))
+        {
+            return false;
+        }
+    }
+
+    if (table && (!hasPlunger || !hasBall))
+    {
+        fprintf(stderr, "%s: a table needs a plunger and a ball\n", filename);
+        return false;
+    }
+    return true;
+}
+
+bool parseTableText(Table* table, const char* text, const char* filename)
+{
+    TableSizes sizes = {};
+    if (!readLines(nullptr, &sizes, text, filename))
+    {
+        return false;
+    }
+    // The ditch past the last one that fits is reported with its line number
+    if (sizes.numDitches > ditchesCap)
+    {
+        sizes.numDitches = ditchesCap;
+    }
+
+    allocTable(table, &sizes);
+    setDefaultMaterials(table);
+    if (!readLines(table, &sizes, text, filename))
+    {
+        freeTable(table);
+        return false;
+    }
+    if (!buildCollisionField(table))
+    {
+        freeTable(table);
+        return false;
+    }
+    return true;
+}
+
+static void writeSegment(FILE* file, const char* keyword, const LineSegment& s)
+{
+    fprintf(file, "%s %.9g %.9g %.9g %.9g\n", keyword, s.p0.x, s.p0.y, s.p1.x, s.p1.y);
+}
+
+static void writeArc(FILE* file, const char* keyword, const Arc& arc, int steps)
+{
+    fprintf(file, "%s %.9g %.9g %.9g %.9g %.9g %d\n", keyword, arc.p.x, arc.p.y, arc.r, arc.start, arc.end, steps);
+}
+
+// Numbers are written with 9 significant digits, enough to read back the same floats
+bool writeTableText(const Table* table, const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+
+    fprintf(file, "# my_pinball table, see tablefile.h for the format\n\n");
+    for (int i = 0; i < table->numBasicWalls; ++i)
+    {
+        writeSegment(file, "wall", table->basicWalls[i]);
+    }
+    for (int i = 0; i < table->numMirroredWalls; ++i)
+    {
+        writeSegment(file, "mirrored_wall", table->mirroredWalls[i]);
+    }
+    for (int i = 0; i < table->numSlingshotWalls; ++i)
+    {
+        writeSegment(file, "slingshot", table->slingshotWalls[i]);
+    }
+    for (int i = 0; i < table->numOneWayWalls; ++i)
+    {
+        writeSegment(file, "one_way_wall", table->oneWayWalls[i]);
+    }
+    fprintf(file, "\n");
+    for (int i = 0; i < table->numArcs; ++i)
+    {
+        writeArc(file, "arc", table->arcs[i], table->arcSteps[i]);
+    }
+    for (int i = 0; i < table->numMirroredArcs; ++i)
+    {
+        writeArc(file, "mirrored_arc", table->mirroredArcs[i], table->mirroredArcSteps[i]);
+    }
+    fprintf(file, "\n");
+    for (int i = 0; i < table->numCapsules; ++i)
+    {
+        fprintf(file, "capsule %.9g %.9g\n", table->capsules[i].x, table->capsules[i].y);
+    }
+    for (int i = 0; i < table->numPopBumpers; ++i)
+    {
+        fprintf(file, "pop_bumper %.9g %.9g\n", table->popBumpers[i].x, table->popBumpers[i].y);
+    }
+    for (int i = 0; i < table->numButtons; ++i)
+    {
+        const Button& b = table->buttons[i];
+        fprintf(file, "button %.9g %.9g %.9g %.9g\n", b.p.x, b.p.y, b.n.x, b.n.y);
+    }
+    for (int i = 0; i < table->numDitches; ++i)
+    {
+        const Ditch& d = table->ditches[i];
+        fprintf(file, "ditch %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n",
+            d.floor.p0.x, d.floor.p0.y, d.floor.p1.x, d.floor.p1.y, d.lid.p0.x, d.lid.p0.y, d.lid.p1.x, d.lid.p1.y);
+    }
+    fprintf(file, "\n");
+    fprintf(file, "plunger %.9g %.9g %.9g\n", table->plungerLeftX, table->plungerRightX, table->plungerTopY);
+    fprintf(file, "ball %.9g %.9g\n", table->initialBallPosition.x, table->initialBallPosition.y);
+    fprintf(file, "\n");
+    fprintf(file, "bounciness slingshot %.9g\n", table->slingshotBounciness);
+    fprintf(file, "bounciness pop_bumper %.9g\n", table->popBumperBounciness);
+    fprintf(file, "bounciness button %.9g\n", table->buttonBounciness);
+    fprintf(file, "score slingshot %d\n", table->slingshotScore);
+    fprintf(file, "score pop_bumper %d\n", table->popBumperScore);
+    fprintf(file, "score button %d\n", table->buttonScore);
+
+    bool isOk = ferror(file) == 0;
+    isOk = fclose(file) == 0 && isOk;
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    return isOk;
+}
+
+// Everything in a baked table before the arrays. Only 4 byte fields, so there's no padding to hash.
+struct BakedTable
+{
+    TableSizes sizes;
+    Ditch ditches[ditchesCap];
+    float plungerLeftX;
+    float plungerRightX;
+    float plungerTopY;
+    Vec2 initialBallPosition;
+    float slingshotBounciness;
+    float popBumperBounciness;
+    float buttonBounciness;
+    int32_t slingshotScore;
+    int32_t popBumperScore;
+    int32_t buttonScore;
+};
+
+static BakedTable getBakedTable(const Table* table)
+{
+    BakedTable baked = {};
+    baked.sizes = getTableSizes(table);
+    memcpy(baked.ditches, table->ditches, sizeof baked.ditches);
+    baked.plungerLeftX = table->plungerLeftX;
+    baked.plungerRightX = table->plungerRightX;
+    baked.plungerTopY = table->plungerTopY;
+    baked.initialBallPosition = table->initialBallPosition;
+    baked.slingshotBounciness = table->slingshotBounciness;
+    baked.popBumperBounciness = table->popBumperBounciness;
+    baked.buttonBounciness = table->buttonBounciness;
+    baked.slingshotScore = table->slingshotScore;
+    baked.popBumperScore = table->popBumperScore;
+    baked.buttonScore = table->buttonScore;
+    return baked;
+}
+
+struct TableArray
+{
+    void* data;
+    size_t size;
+};
+
+constexpr int numTableArrays = 11;
+
+// In the order they follow the BakedTable
+static void getTableArrays(const Table* table, const TableSizes* sizes, TableArray arrays[numTableArrays])
+{
+    int i = 0;
+    arrays[i++] = { table->basicWalls, (size_t)sizes->numBasicWalls * sizeof(LineSegment) };
+    arrays[i++] = { table->mirroredWalls, (size_t)sizes->numMirroredWalls * sizeof(LineSegment) };
+    arrays[i++] = { table->slingshotWalls, (size_t)sizes->numSlingshotWalls * sizeof(LineSegment) };
+    arrays[i++] = { table->oneWayWalls, (size_t)sizes->numOneWayWalls * sizeof(LineSegment) };
+    arrays[i++] = { table->arcs, (size_t)sizes->numArcs * sizeof(Arc) };
+    arrays[i++] = { table->arcSteps, (size_t)sizes->numArcs * sizeof(int) };
+    arrays[i++] = { table->mirroredArcs, (size_t)sizes->numMirroredArcs * sizeof(Arc) };
+    arrays[i++] = { table->mirroredArcSteps, (size_t)sizes->numMirroredArcs * sizeof(int) };
+    arrays[i++] = { table->capsules, (size_t)sizes->numCapsules * sizeof(Vec2) };
+    arrays[i++] = { table->popBumpers, (size_t)sizes->numPopBumpers * sizeof(Vec2) };
+    arrays[i++] = { table->buttons, (size_t)sizes->numButtons * sizeof(Button) };
+    assert(i == numTableArrays);
+}
+
+constexpr int numFieldArrays = 3;
+constexpr int numFieldStarts = numFieldCells * numStaticKinds + 1;
+
+// In the order they follow the table's arrays and the number of indices
+static void getFieldArrays(const CollisionField* field, int numIndices, TableArray arrays[numFieldArrays])
+{
+    arrays[0] = { field->distances, (size_t)numFieldCells * sizeof(float) };
+    arrays[1] = { field->starts, (size_t)numFieldStarts * sizeof(int32_t) };
+    arrays[2] = { field->indices, (size_t)numIndices * sizeof(int32_t) };
+}
+
+// FNV-1a
+static uint32_t hashBytes(uint32_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// The field is made from the primitives, so it's left out and the checksums of input logs stay as they were
+uint32_t getTableChecksum(const Table* table)
+{
+    BakedTable baked = getBakedTable(table);
+    TableArray arrays[numTableArrays];
+    getTableArrays(table, &baked.sizes, arrays);
+
+    uint32_t hash = hashBytes(2166136261u, &baked, sizeof baked);
+    for (int i = 0; i < numTableArrays; ++i)
+    {
+        hash = hashBytes(hash, arrays[i].data, arrays[i].size);
+    }
+    return hash;
+}
+
+size_t getBakedTableSize(const Table* table)
+{
+    TableSizes sizes = getTableSizes(table);
+    TableArray arrays[numTableArrays];
+    getTableArrays(table, &sizes, arrays);
+
+    TableArray fieldArrays[numFieldArrays];
+    getFieldArrays(&table->field, table->field.numIndices, fieldArrays);
+
+    size_t size = sizeof(BakedTableHeader) + sizeof(BakedTable) + sizeof(int32_t);
+    for (int i = 0; i < numTableArrays; ++i)
+    {
+        size += arrays[i].size;
+    }
+    for (int i = 0; i < numFieldArrays; ++i)
+    {
+        size += fieldArrays[i].size;
+    }
+    return size;
+}
+
+bool writeBakedTable(const Table* table, const char* filename)
+{
+    assert(table->field.starts);
+    BakedTable baked = getBakedTable(table);
+    TableArray arrays[numTableArrays];
+    getTableArrays(table, &baked.sizes, arrays);
+    int32_t numIndices = table->field.numIndices;
+    TableArray fieldArrays[numFieldArrays];
+    getFieldArrays(&table->field, numIndices, fieldArrays);
+
+    BakedTableHeader header = {};
+    header.magic = bakedTableMagic;
+    header.version = bakedTableVersion;
+    header.dataSize = (uint32_t)(getBakedTableSize(table) - sizeof header);
+    header.checksum = getTableChecksum(table);
+
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+    bool isOk = fwrite(&header, sizeof header, 1, file) == 1 && fwrite(&baked, sizeof baked, 1, file) == 1;
+    for (int i = 0; i < numTableArrays && isOk; ++i)
+    {
+        isOk = arrays[i].size == 0 || fwrite(arrays[i].data, arrays[i].size, 1, file) == 1;
+    }
+    isOk = isOk && fwrite(&numIndices, sizeof numIndices, 1, file) == 1;
+    for (int i = 0; i < numFieldArrays && isOk; ++i)
+    {
+        isOk = fieldArrays[i].size == 0 || fwrite(fieldArrays[i].data, fieldArrays[i].size, 1, file) == 1;
+    }
+    isOk = fclose(file) == 0 && isOk;
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    return isOk;
+}
+
+static bool areSizesValid(const TableSizes* sizes)
+{
+    return sizes->numBasicWalls >= 0 && sizes->numMirroredWalls >= 0 && sizes->numSlingshotWalls >= 0 &&
+        sizes->numOneWayWalls >= 0 && sizes->numArcs >= 0 && sizes->numMirroredArcs >= 0 &&
+        sizes->numCapsules >= 0 && sizes->numPopBumpers >= 0 && sizes->numButtons >= 0 &&
+        sizes->numDitches >= 0 && sizes->numDitches <= ditchesCap;
+}
+
+static bool areStepsValid(const int* steps, int numArcs)
+{
+    for (int i = 0; i < numArcs; ++i)
+    {
+        if (steps[i] < 2 || steps[i] > arcStepsMax)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The lists of the field index the primitive arrays too
+static bool isFieldValid(const CollisionField* field, const TableSizes* sizes)
+{
+    const int counts[numStaticKinds] = {
+        sizes->numBasicWalls, sizes->numMirroredWalls, sizes->numArcs, sizes->numMirroredArcs, sizes->numCapsules,
+        sizes->numPopBumpers,
+    };
+    if (field->starts[0] != 0 || field->starts[numFieldStarts - 1] != field->numIndices)
+    {
+        return false;
+    }
+    for (int j = 0; j < numFieldStarts - 1; ++j)
+    {
+        if (field->starts[j] > field->starts[j + 1])
+        {
+            return false;
+        }
+        for (int k = field->starts[j]; k < field->starts[j + 1]; ++k)
+        {
+            if (field->indices[k] < 0 || field->indices[k] >= counts[j % numStaticKinds])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// What parseLine() checks, for baked tables
+static bool isTableInRange(const Table* table)
+{
+    const LineSegment* segmentArrays[] = { table->basicWalls, table->mirroredWalls, table->slingshotWalls, table->oneWayWalls };
+    const int segmentCounts[] = { table->numBasicWalls, table->numMirroredWalls, table->numSlingshotWalls, table->numOneWayWalls };
+    for (int i = 0; i < table->numMirroredWalls; ++i)
+    {
+        if (!canStoreMirrored(table->mirroredWalls[i])) return false;
+    }
+    for (int i = 0; i < table->numMirroredArcs; ++i)
+    {
+        if (!canStoreMirrored(table->mirroredArcs[i])) return false;
+    }
+    for (int j = 0; j < 4; ++j)
+    {
+        for (int i = 0; i < segmentCounts[j]; ++i)
+        {
+            const LineSegment& s = segmentArrays[j][i];
+            if (!isCoordInRange(s.p0.x) || !isCoordInRange(s.p0.y) || !isCoordInRange(s.p1.x) || !isCoordInRange(s.p1.y))
+            {
+                return false;
+            }
+        }
+    }
+    for (int i = 0; i < table->numArcs; ++i)
+    {
+        if (!isArcValid(table->arcs[i]) || !isArcInRange(table->arcs[i])) return false;
+    }
+    for (int i = 0; i < table->numMirroredArcs; ++i)
+    {
+        if (!isArcValid(table->mirroredArcs[i]) || !isArcInRange(table->mirroredArcs[i])) return false;
+    }
+    for (int i = 0; i < table->numCapsules; ++i)
+    {
+        if (!isCoordInRange(table->capsules[i].x) || !isCoordInRange(table->capsules[i].y)) return false;
+    }
+    for (int i = 0; i < table->numPopBumpers; ++i)
+    {
+        if (!isCoordInRange(table->popBumpers[i].x) || !isCoordInRange(table->popBumpers[i].y)) return false;
+    }
+    for (int i = 0; i < table->numButtons; ++i)
+    {
+        const Button& b = table->buttons[i];
+        if (!isCoordInRange(b.p.x) || !isCoordInRange(b.p.y) || !isNormalValid(b.n)) return false;
+    }
+    for (int i = 0; i < table->numDitches; ++i)
+    {
+        const Ditch& d = table->ditches[i];
+        const float coords[] = { d.floor.p0.x, d.floor.p0.y, d.floor.p1.x, d.floor.p1.y, d.lid.p0.x, d.lid.p0.y, d.lid.p1.x, d.lid.p1.y };
+        for (float x : coords)
+        {
+            if (!isCoordInRange(x)) return false;
+        }
+    }
+    if (!isBouncinessValid(table->slingshotBounciness) || !isBouncinessValid(table->popBumperBounciness) ||
+        !isBouncinessValid(table->buttonBounciness))
+    {
+        return false;
+    }
+    return isCoordInRange(table->plungerLeftX) && isCoordInRange(table->plungerRightX) &&
+        isCoordInRange(table->plungerTopY) && isCoordInRange(table->initialBallPosition.x) &&
+        isCoordInRange(table->initialBallPosition.y);
+}
+
+// The game indexes its arrays with the counts, a damaged file mustn't take it out of bounds
+static bool loadBakedTable(Table* table, const unsigned char* data, size_t size, const char* filename)
+{
+    BakedTableHeader header;
+    memcpy(&header, data, sizeof header);
+    if (header.version != bakedTableVersion)
+    {
+        fprintf(stderr, "%s was baked by another version of my_pinball, bake it again\n", filename);
+        return false;
+    }
+
+    BakedTable baked;
+    if (size != sizeof header + header.dataSize || header.dataSize < sizeof baked)
+    {
+        fprintf(stderr, "%s is damaged\n", filename);
+        return false;
+    }
+    memcpy(&baked, data + sizeof header, sizeof baked);
+
+    // Sizes that don't add up to the file can't be trusted with an allocation
+    TableArray arrays[numTableArrays];
+    TableArray fieldArrays[numFieldArrays];
+    size_t dataSize = sizeof baked;
+    int32_t numIndices = -1;
+    if (areSizesValid(&baked.sizes))
+    {
+        Table empty = {};
+        getTableArrays(&empty, &baked.sizes, arrays);
+        for (int i = 0; i < numTableArrays; ++i)
+        {
+            dataSize += arrays[i].size;
+        }
+        if (header.dataSize >= dataSize + sizeof numIndices)
+        {
+            memcpy(&numIndices, data + sizeof header + dataSize, sizeof numIndices);
+            dataSize += sizeof numIndices;
+        }
+        if (numIndices >= 0)
+        {
+            getFieldArrays(&empty.field, numIndices, fieldArrays);
+            for (int i = 0; i < numFieldArrays; ++i)
+            {
+                dataSize += fieldArrays[i].size;
+            }
+        }
+    }
+    if (!areSizesValid(&baked.sizes) || numIndices < 0 || dataSize != header.dataSize)
+    {
+        fprintf(stderr, "%s is damaged\n", filename);
+        return false;
+    }
+
+    allocTable(table, &baked.sizes);
+    getTableArrays(table, &baked.sizes, arrays);
+    const unsigned char* ptr = data + sizeof header + sizeof baked;
+    for (int i = 0; i < numTableArrays; ++i)
+    {
+        if (arrays[i].size)
+        {
+            memcpy(arrays[i].data, ptr, arrays[i].size);
+        }
+        ptr += arrays[i].size;
+    }
+    ptr += sizeof numIndices;
+    if (!allocCollisionField(&table->field, numIndices))
+    {
+        fprintf(stderr, "Out of memory for the collision field of %s\n", filename);
+        freeTable(table);
+        return false;
+    }
+    getFieldArrays(&table->field, numIndices, fieldArrays);
+    for (int i = 0; i < numFieldArrays; ++i)
+    {
+        if (fieldArrays[i].size)
+        {
+            memcpy(fieldArrays[i].data, ptr, fieldArrays[i].size);
+        }
+        ptr += fieldArrays[i].size;
+    }
+
+    table->numBasicWalls = baked.sizes.numBasicWalls;
+    table->numMirroredWalls = baked.sizes.numMirroredWalls;
+    table->numSlingshotWalls = baked.sizes.numSlingshotWalls;
+    table->numOneWayWalls = baked.sizes.numOneWayWalls;
+    table->numArcs = baked.sizes.numArcs;
+    table->numMirroredArcs = baked.sizes.numMirroredArcs;
+    table->numCapsules = baked.sizes.numCapsules;
+    table->numPopBumpers = baked.sizes.numPopBumpers;
+    table->numButtons = baked.sizes.numButtons;
+    table->numDitches = baked.sizes.numDitches;
+    memcpy(table->ditches, baked.ditches, sizeof baked.ditches);
+    table->plungerLeftX = baked.plungerLeftX;
+    table->plungerRightX = baked.plungerRightX;
+    table->plungerCenterX = (baked.plungerLeftX + baked.plungerRightX) / 2.0f;
+    table->plungerTopY = baked.plungerTopY;
+    table->initialBallPosition = baked.initialBallPosition;
+    table->slingshotBounciness = baked.slingshotBounciness;
+    table->popBumperBounciness = baked.popBumperBounciness;
+    table->buttonBounciness = baked.buttonBounciness;
+    table->slingshotScore = baked.slingshotScore;
+    table->popBumperScore = baked.popBumperScore;
+    table->buttonScore = baked.buttonScore;
+
+    // The arc steps size the vertex buffers
+    if (getTableChecksum(table) != header.checksum ||
+        !areStepsValid(table->arcSteps, table->numArcs) ||
+        !areStepsValid(table->mirroredArcSteps, table->numMirroredArcs) ||
+        !isFieldValid(&table->field, &baked.sizes) ||
+        !isTableInRange(table))
+    {
+        fprintf(stderr, "%s is damaged\n", filename);
+        freeTable(table);
+        return false;
+    }
+    return true;
+}
+
+bool loadTable(Table* table, const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (fileSize < 0)
+    {
+        fprintf(stderr, "Failed to read %s\n", filename);
+        fclose(file);
+        return false;
+    }
+
+    // Zero terminated for the text parser
+    size_t size = (size_t)fileSize;
+    unsigned char* data = (unsigned char*)malloc(size + 1);
+    bool isOk = fread(data, 1, size, file) == size;
+    fclose(file);
+    data[size] = '\0';
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to read %s\n", filename);
+    }
+    else
+    {
+        uint32_t magic = 0;
+        if (size >= sizeof(BakedTableHeader))
+        {
+            memcpy(&magic, data, sizeof magic);
+        }
+        if (magic == bakedTableMagic)
+        {
+            isOk = loadBakedTable(table, data, size, filename);
+        }
+        else
+        {
+            isOk = parseTableText(table, (const char*)data, filename);
+        }
+    }
+
+    free(data);
+    return isOk;
+}
+
+bool initTable(Table* table, const char* filename)
+{
+    if (!filename)
+    {
+        buildTable(table);
+        return true;
+    }
+    return loadTable(table, filename);
+}
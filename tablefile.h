@@ -0,0 +1,57 @@
+#pragma once
+
+#include "game.h"
+
+// Tables loaded from files instead of buildTable(). The text format has one primitive per line, a
+// keyword followed by numbers in world units and radians, # starts a comment. Coordinates go from -120 to
+// 120 (tableCoordMax), arcs included:
+//
+//   wall X0 Y0 X1 Y1
+//   mirrored_wall X0 Y0 X1 Y1                  at x <= -1, the right half is reflected across x = 0
+//   slingshot X0 Y0 X1 Y1
+//   one_way_wall X0 Y0 X1 Y1
+//   arc CX CY R START END STEPS                counterclockwise from START to END, STEPS lines when drawn
+//   mirrored_arc CX CY R START END STEPS
+//   capsule X Y
+//   pop_bumper X Y
+//   button X Y NX NY                           center of the bottom edge and the outward normal
+//   ditch FX0 FY0 FX1 FY1 LX0 LY0 LX1 LY1      floor and lid
+//   plunger LEFT_X RIGHT_X TOP_Y
+//   ball X Y                                   where the ball is served
+//   bounciness slingshot|pop_bumper|button B   0 to 20, default to the built-in table's
+//   score slingshot|pop_bumper|button POINTS
+//
+// my_pinball_bake turns it into a baked table: a small header, the counts and the other scalars of
+// the table, then its arrays as the game uses them, so loading one is a single read with no parsing.
+// The collision field comes last, the number of its indices and then its arrays, so it isn't built
+// again on load either.
+
+constexpr uint32_t bakedTableMagic = 0x42544250; // "PBTB"
+constexpr uint32_t bakedTableVersion = 3;
+
+struct BakedTableHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    // Bytes after the header
+    uint32_t dataSize;
+    // getTableChecksum() of the table
+    uint32_t checksum;
+};
+
+// All of these print what went wrong to stderr and return false on failure. The tables they load are
+// allocated to fit and need a freeTable().
+bool parseTableText(Table* table, const char* text, const char* filename);
+bool writeTableText(const Table* table, const char* filename);
+bool writeBakedTable(const Table* table, const char* filename);
+
+// Loads a baked or a text table, told apart by the magic
+bool loadTable(Table* table, const char* filename);
+
+// buildTable() when filename is null
+bool initTable(Table* table, const char* filename);
+
+// FNV-1a of the table as it's baked, two tables with the same primitives and settings match
+uint32_t getTableChecksum(const Table* table);
+// Size of the baked file, header included
+size_t getBakedTableSize(const Table* table);
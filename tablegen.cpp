@@ -0,0 +1,118 @@
+#include "tablegen.h"
+
+#include <string.h>
+
+// Where the primitives go, above the slingshots and left of the plunger lane
+constexpr float generatedMinX = -18.0f;
+constexpr float generatedMaxX = 18.0f;
+constexpr float generatedMinY = 24.0f;
+constexpr float generatedMaxY = 60.0f;
+
+constexpr float generatedWallLength = 1.5f;
+constexpr float generatedArcRadius = 1.0f;
+constexpr int generatedArcSteps = 8;
+
+static_assert(-generatedMinX + generatedWallLength <= tableCoordMax && generatedMaxX + generatedWallLength <= tableCoordMax &&
+    generatedMaxY + generatedWallLength <= tableCoordMax, "Generated primitives have to fit in the vertex range");
+
+// xorshift32
+static float getRandomFloat(uint32_t* state, float min, float max)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return min + (max - min) * (float)(x >> 8) / (float)0xffffff;
+}
+
+static Vec2 getRandomPoint(uint32_t* state)
+{
+    return { getRandomFloat(state, generatedMinX, generatedMaxX), getRandomFloat(state, generatedMinY, generatedMaxY) };
+}
+
+bool generateTable(Table* table, int numPrimitives, uint32_t seed)
+{
+    Table base;
+    buildTable(&base);
+
+    int numPopBumpers = numPrimitives / 3;
+    int numArcs = numPrimitives / 3;
+    int numWalls = numPrimitives - numPopBumpers - numArcs;
+
+    TableSizes sizes = getTableSizes(&base);
+    sizes.numBasicWalls += numWalls;
+    sizes.numArcs += numArcs;
+    sizes.numPopBumpers += numPopBumpers;
+    allocTable(table, &sizes);
+
+    // Everything of the built-in table but the arrays carries over as is
+    Arena arena = table->arena;
+    LineSegment* basicWalls = table->basicWalls;
+    LineSegment* mirroredWalls = table->mirroredWalls;
+    LineSegment* slingshotWalls = table->slingshotWalls;
+    LineSegment* oneWayWalls = table->oneWayWalls;
+    Arc* arcs = table->arcs;
+    int* arcSteps = table->arcSteps;
+    Arc* mirroredArcs = table->mirroredArcs;
+    int* mirroredArcSteps = table->mirroredArcSteps;
+    Vec2* capsules = table->capsules;
+    Vec2* popBumpers = table->popBumpers;
+    Button* buttons = table->buttons;
+    *table = base;
+    table->arena = arena;
+    // The base's goes with it, this one is built for the new primitives
+    table->field = {};
+
+#define COPY_ARRAY(array, count)                                                                  \
+    memcpy(array, base.array, (size_t)base.count * sizeof(base.array[0]));                        \
+    table->array = array;
+
+    COPY_ARRAY(basicWalls, numBasicWalls);
+    COPY_ARRAY(mirroredWalls, numMirroredWalls);
+    COPY_ARRAY(slingshotWalls, numSlingshotWalls);
+    COPY_ARRAY(oneWayWalls, numOneWayWalls);
+    COPY_ARRAY(arcs, numArcs);
+    COPY_ARRAY(arcSteps, numArcs);
+    COPY_ARRAY(mirroredArcs, numMirroredArcs);
+    COPY_ARRAY(mirroredArcSteps, numMirroredArcs);
+    COPY_ARRAY(capsules, numCapsules);
+    COPY_ARRAY(popBumpers, numPopBumpers);
+    COPY_ARRAY(buttons, numButtons);
+
+#undef COPY_ARRAY
+
+    freeTable(&base);
+
+    uint32_t state = seed * 0x9e3779b9u;
+    state = state ? state : 1;
+
+    for (int i = 0; i < numWalls; ++i)
+    {
+        Vec2 p = getRandomPoint(&state);
+        float angle = getRandomFloat(&state, 0.0f, twoPi);
+        Vec2 d = Vec2{ cosf(angle), sinf(angle) } * (generatedWallLength / 2.0f);
+        table->basicWalls[table->numBasicWalls++] = { p - d, p + d };
+    }
+
+    for (int i = 0; i < numArcs; ++i)
+    {
+        // Half circles, open in a random direction
+        float start = getRandomFloat(&state, 0.0f, pi - 0.01f);
+        table->arcs[table->numArcs] = { getRandomPoint(&state), generatedArcRadius, start, start + pi };
+        table->arcSteps[table->numArcs] = generatedArcSteps;
+        ++table->numArcs;
+    }
+
+    for (int i = 0; i < numPopBumpers; ++i)
+    {
+        table->popBumpers[table->numPopBumpers++] = getRandomPoint(&state);
+    }
+
+    if (!buildCollisionField(table))
+    {
+        freeTable(table);
+        return false;
+    }
+    return true;
+}
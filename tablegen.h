@@ -0,0 +1,9 @@
+#pragma once
+
+#include "game.h"
+
+// Procedural tables for stress tests: the built-in table with numPrimitives more walls, arcs and pop
+// bumpers, a third of each, scattered over the upper playfield. The same seed gives the same table.
+// Nothing keeps the ball from getting stuck between them, they are there to be counted, not played.
+// Prints what went wrong to stderr and returns false when out of memory.
+bool generateTable(Table* table, int numPrimitives, uint32_t seed);
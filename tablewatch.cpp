@@ -0,0 +1,105 @@
+#include "tablewatch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+bool initTableWatcher(TableWatcher* w, const char* filename)
+{
+    *w = {};
+    w->fd = -1;
+
+    const char* slash = strrchr(filename, '/');
+    const char* name = slash ? slash + 1 : filename;
+    size_t dirLen = slash ? (size_t)(slash - filename) : 0;
+    if (dirLen + 2 > sizeof w->dir || strlen(name) + 1 > sizeof w->name)
+    {
+        fprintf(stderr, "Not watching %s, the path is too long\n", filename);
+        return false;
+    }
+    if (slash)
+    {
+        // "/" when the file is in the root
+        memcpy(w->dir, filename, dirLen ? dirLen : 1);
+    }
+    else
+    {
+        strcpy(w->dir, ".");
+    }
+    strcpy(w->name, name);
+
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0 || inotify_add_watch(w->fd, w->dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        fprintf(stderr, "Not watching %s: %s\n", filename, strerror(errno));
+        freeTableWatcher(w);
+        return false;
+    }
+    return true;
+}
+
+void freeTableWatcher(TableWatcher* w)
+{
+    if (w->fd >= 0)
+    {
+        close(w->fd);
+    }
+    w->fd = -1;
+}
+
+bool pollTableWatcher(TableWatcher* w)
+{
+    if (w->fd < 0)
+    {
+        return false;
+    }
+
+    // An editor saving once can make several events, they are all drained and reported as one
+    bool isChanged = false;
+    alignas(inotify_event) char buf[4096];
+    for (;;)
+    {
+        ssize_t len = read(w->fd, buf, sizeof buf);
+        if (len <= 0)
+        {
+            break;
+        }
+        for (char* ptr = buf; ptr < buf + len;)
+        {
+            const inotify_event* event = (const inotify_event*)ptr;
+            if (event->len > 0 && strcmp(event->name, w->name) == 0)
+            {
+                isChanged = true;
+            }
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+    return isChanged;
+}
+
+#else
+
+bool initTableWatcher(TableWatcher* w, const char* filename)
+{
+    *w = {};
+    w->fd = -1;
+    fprintf(stderr, "Not watching %s, reloading tables needs inotify\n", filename);
+    return false;
+}
+
+void freeTableWatcher(TableWatcher* w)
+{
+    w->fd = -1;
+}
+
+bool pollTableWatcher(TableWatcher* /*w*/)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+// Notices when a table file is saved, so the game can reload it while it runs. Watches the directory
+// rather than the file since editors often save by writing a new file and renaming it over the old one.
+// Linux only (inotify), elsewhere nothing is ever noticed.
+struct TableWatcher
+{
+    int fd;
+    char dir[1024];
+    char name[256];
+};
+
+// Prints a warning and returns false if the file can't be watched
+bool initTableWatcher(TableWatcher* w, const char* filename);
+void freeTableWatcher(TableWatcher* w);
+
+// True if the file has been written since the last call, doesn't block
+bool pollTableWatcher(TableWatcher* w);
@@ -0,0 +1,519 @@
+// Replays recorded games (see inputlog.h) through the whole fixed-step simulation, optionally filling
+// the render data and laying out the text of every frame too, and reports simulation ticks per second
+// with the time of each phase and the spread across runs. Without logs the workload is a few games of
+// the autoplayer, recorded first and then replayed. The results can be saved as JSON and compared
+// against a saved baseline, exiting with 1 when a phase got slower than the threshold allows. Built with
+// allocation tracking (see alloctrack.h) it also exits with 1 when any frame allocated.
+
+#include "alloctrack.h"
+#include "autoplay.h"
+#include "game.h"
+#include "inputlog.h"
+#include "tablefile.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+constexpr int throughputLogsCap = 256;
+constexpr int throughputRunsCap = 64;
+
+struct ThroughputOptions
+{
+    const char* logFilenames[throughputLogsCap];
+    int numLogs;
+    const char* tableFilename;
+    int numGames;
+    int numFrames;
+    int numRuns;
+    bool isRendering;
+    const char* corpusDir;
+    const char* jsonFilename;
+    const char* baselineFilename;
+    double threshold;
+};
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: my_pinball_throughput [options] [LOG...]\n"
+        "  LOG...           input logs to replay, recorded with my_pinball --record-inputs\n"
+        "  --games N        without logs, record N autoplayer games to replay (default 8)\n"
+        "  --frames N       frames of each autoplayer game, at 60 per second (default 3600)\n"
+        "  --write-corpus D write the autoplayer games to D/game_NN.pbin and exit\n"
+        "  --table F        load the table from F, a text or baked table (see tablefile.h)\n"
+        "  --runs N         times to replay the whole workload (default 5)\n"
+        "  --render         also fill the render data and lay out the text every frame\n"
+        "  --json F         write the results to F\n"
+        "  --baseline F     compare with results written by --json, exit with 1 on a regression\n"
+        "  --threshold P    percent a phase may get slower before it's a regression (default 5)\n");
+}
+
+static bool parseOptions(int argc, char** argv, ThroughputOptions* opts)
+{
+    *opts = {};
+    opts->numGames = 8;
+    opts->numFrames = 3600;
+    opts->numRuns = 5;
+    opts->threshold = 5.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (arg[0] != '-')
+        {
+            if (opts->numLogs == throughputLogsCap)
+            {
+                return false;
+            }
+            opts->logFilenames[opts->numLogs++] = arg;
+            continue;
+        }
+        if (strcmp(arg, "--render") == 0)
+        {
+            opts->isRendering = true;
+            continue;
+        }
+
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value)
+        {
+            return false;
+        }
+        ++i;
+
+        if (strcmp(arg, "--games") == 0)
+        {
+            opts->numGames = atoi(value);
+        }
+        else if (strcmp(arg, "--frames") == 0)
+        {
+            opts->numFrames = atoi(value);
+        }
+        else if (strcmp(arg, "--write-corpus") == 0)
+        {
+            opts->corpusDir = value;
+        }
+        else if (strcmp(arg, "--table") == 0)
+        {
+            opts->tableFilename = value;
+        }
+        else if (strcmp(arg, "--runs") == 0)
+        {
+            opts->numRuns = atoi(value);
+        }
+        else if (strcmp(arg, "--json") == 0)
+        {
+            opts->jsonFilename = value;
+        }
+        else if (strcmp(arg, "--baseline") == 0)
+        {
+            opts->baselineFilename = value;
+        }
+        else if (strcmp(arg, "--threshold") == 0)
+        {
+            opts->threshold = atof(value);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return opts->numGames > 0 && opts->numGames <= throughputLogsCap && opts->numFrames > 0 && opts->numRuns > 0 &&
+        opts->numRuns <= throughputRunsCap && opts->threshold >= 0.0;
+}
+
+static double getSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Plays a game with the autoplayer and keeps its inputs
+static void recordAutoplay(InputLog* log, const Table* table, uint32_t seed, int numFrames)
+{
+    constexpr float frameDt = 1.0f / 60.0f;
+    initInputLog(log, seed, table);
+    Game game;
+    initGame(&game, table, seed);
+    for (int frameIndex = 0; frameIndex < numFrames; ++frameIndex)
+    {
+        GameInput input = getAutoplayInput(&game, frameIndex);
+        addInputFrame(log, input, frameDt);
+        updateGame(&game, input, frameDt);
+    }
+}
+
+// FNV-1a
+static uint32_t hashBytes(uint32_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+struct RunTimes
+{
+    double simTime;
+    double fillTime;
+    double layoutTime;
+    uint32_t numTicks;
+    // Of where every game ended up, the same in every run unless the simulation changed
+    uint32_t stateHash;
+};
+
+static RunTimes replayLogs(const InputLog* logs, int numLogs, const Table* table, bool isRendering, RenderData* rd)
+{
+    RunTimes times = {};
+    times.stateHash = 2166136261u;
+    for (int i = 0; i < numLogs; ++i)
+    {
+        const InputLog* log = &logs[i];
+        Game game;
+        initGame(&game, table, log->seed);
+        Hud hud;
+        if (isRendering)
+        {
+            initRenderData(rd, &hud, table);
+        }
+
+        for (int frameIndex = 0; frameIndex < log->numFrames; ++frameIndex)
+        {
+            const InputFrame* frame = &log->frames[frameIndex];
+            AllocCheck allocCheck;
+            beginAllocCheck(&allocCheck, "a replayed frame");
+
+            double simStart = getSeconds();
+            updateGame(&game, getFrameInput(frame), frame->frameDt);
+            double simEnd = getSeconds();
+            times.simTime += simEnd - simStart;
+
+            if (isRendering)
+            {
+                fillRenderData(rd, &hud, &game);
+                double fillEnd = getSeconds();
+                if (rd->isTextDirty)
+                {
+                    layoutText(rd);
+                }
+                double layoutEnd = getSeconds();
+                times.fillTime += fillEnd - simEnd;
+                times.layoutTime += layoutEnd - fillEnd;
+            }
+
+            endAllocCheck(&allocCheck);
+        }
+
+        times.numTicks += game.numTicks;
+        times.stateHash = hashBytes(times.stateHash, &game.ball, sizeof game.ball);
+        times.stateHash = hashBytes(times.stateHash, &game.score, sizeof game.score);
+        if (isRendering)
+        {
+            freeRenderData(rd);
+        }
+    }
+    return times;
+}
+
+struct ThroughputResults
+{
+    int numRuns;
+    int numFrames;
+    uint32_t numTicks;
+    uint32_t stateHash;
+    double ticksPerSecond;
+    double ticksPerSecondStddev;
+    double ticksPerSecondMin;
+    double ticksPerSecondMax;
+    double simNsPerTick;
+    // Zero without --render
+    double fillNsPerFrame;
+    double layoutNsPerFrame;
+    // Only counted in builds with MY_PINBALL_ALLOC_TRACKING
+    AllocCounts frameAllocs;
+};
+
+static bool writeJson(const char* filename, const ThroughputResults* r)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+    fprintf(file, "{\n");
+    fprintf(file, "  \"runs\": %d,\n", r->numRuns);
+    fprintf(file, "  \"frames\": %d,\n", r->numFrames);
+    fprintf(file, "  \"ticks\": %u,\n", r->numTicks);
+    fprintf(file, "  \"state_hash\": %u,\n", r->stateHash);
+    fprintf(file, "  \"ticks_per_second\": %.1f,\n", r->ticksPerSecond);
+    fprintf(file, "  \"ticks_per_second_stddev\": %.1f,\n", r->ticksPerSecondStddev);
+    fprintf(file, "  \"ticks_per_second_min\": %.1f,\n", r->ticksPerSecondMin);
+    fprintf(file, "  \"ticks_per_second_max\": %.1f,\n", r->ticksPerSecondMax);
+    fprintf(file, "  \"sim_ns_per_tick\": %.1f,\n", r->simNsPerTick);
+    fprintf(file, "  \"fill_ns_per_frame\": %.1f,\n", r->fillNsPerFrame);
+    fprintf(file, "  \"layout_ns_per_frame\": %.1f%s\n", r->layoutNsPerFrame, isAllocTracking ? "," : "");
+    if (isAllocTracking)
+    {
+        fprintf(file, "  \"frame_allocations\": %llu\n", (unsigned long long)r->frameAllocs.numAllocs);
+    }
+    fprintf(file, "}\n");
+
+    bool isOk = ferror(file) == 0;
+    isOk = fclose(file) == 0 && isOk;
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    return isOk;
+}
+
+// Only reads the flat objects writeJson() writes
+static bool readJsonNumber(const char* json, const char* key, double* value)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof pattern, "\"%s\":", key);
+    const char* ptr = strstr(json, pattern);
+    if (!ptr)
+    {
+        return false;
+    }
+    ptr += strlen(pattern);
+    char* end;
+    *value = strtod(ptr, &end);
+    return end != ptr;
+}
+
+static char* readFile(const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        return nullptr;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (char*)malloc((size_t)(size > 0 ? size : 0) + 1);
+    size_t numRead = size > 0 ? fread(text, 1, (size_t)size, file) : 0;
+    text[numRead] = '\0';
+    fclose(file);
+    return text;
+}
+
+// Prints one line per phase, returns false if any got slower than the threshold allows
+static bool compareWithBaseline(const ThroughputResults* r, const char* filename, double threshold)
+{
+    char* json = readFile(filename);
+    if (!json)
+    {
+        return false;
+    }
+
+    double baseTicksPerSecond, baseSimNs, baseFillNs, baseLayoutNs, baseStateHash;
+    bool isOk = readJsonNumber(json, "ticks_per_second", &baseTicksPerSecond) &&
+        readJsonNumber(json, "sim_ns_per_tick", &baseSimNs) &&
+        readJsonNumber(json, "fill_ns_per_frame", &baseFillNs) &&
+        readJsonNumber(json, "layout_ns_per_frame", &baseLayoutNs) &&
+        readJsonNumber(json, "state_hash", &baseStateHash);
+    free(json);
+    if (!isOk)
+    {
+        fprintf(stderr, "%s is not a my_pinball_throughput result\n", filename);
+        return false;
+    }
+
+    if ((uint32_t)baseStateHash != r->stateHash)
+    {
+        printf("The games played out differently than in %s, the workloads aren't the same\n", filename);
+    }
+
+    struct Phase
+    {
+        const char* name;
+        double baseline;
+        double current;
+        bool isHigherBetter;
+    };
+    Phase phases[] = {
+        { "ticks/s", baseTicksPerSecond, r->ticksPerSecond, true },
+        { "sim ns/tick", baseSimNs, r->simNsPerTick, false },
+        { "fill ns/frame", baseFillNs, r->fillNsPerFrame, false },
+        { "layout ns/frame", baseLayoutNs, r->layoutNsPerFrame, false },
+    };
+
+    bool isPassing = true;
+    printf("%-16s %12s %12s %9s\n", "vs baseline", "baseline", "now", "change");
+    for (const Phase& p : phases)
+    {
+        // Phases that weren't measured in both
+        if (p.baseline <= 0.0 || p.current <= 0.0)
+        {
+            continue;
+        }
+        double change = (p.current - p.baseline) / p.baseline * 100.0;
+        double slowdown = p.isHigherBetter ? -change : change;
+        bool isRegression = slowdown > threshold;
+        printf("%-16s %12.1f %12.1f %+8.1f%%%s\n", p.name, p.baseline, p.current, change, isRegression ? "  REGRESSION" : "");
+        isPassing = isPassing && !isRegression;
+    }
+    return isPassing;
+}
+
+int main(int argc, char** argv)
+{
+    ThroughputOptions opts;
+    if (!parseOptions(argc, argv, &opts))
+    {
+        printUsage();
+        return 1;
+    }
+
+    Table table;
+    if (!initTable(&table, opts.tableFilename))
+    {
+        return 1;
+    }
+
+    int numLogs = opts.numLogs > 0 ? opts.numLogs : opts.numGames;
+    InputLog* logs = (InputLog*)malloc((size_t)numLogs * sizeof(InputLog));
+    if (opts.numLogs > 0)
+    {
+        uint32_t tableChecksum = getTableChecksum(&table);
+        for (int i = 0; i < numLogs; ++i)
+        {
+            if (!loadInputLog(&logs[i], opts.logFilenames[i]))
+            {
+                return 1;
+            }
+            if (logs[i].tableChecksum != tableChecksum)
+            {
+                fprintf(stderr, "Warning: %s was recorded on another table\n", opts.logFilenames[i]);
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < numLogs; ++i)
+        {
+            recordAutoplay(&logs[i], &table, (uint32_t)i + 1, opts.numFrames);
+        }
+    }
+
+    if (opts.corpusDir)
+    {
+        for (int i = 0; i < numLogs; ++i)
+        {
+            char filename[1024];
+            snprintf(filename, sizeof filename, "%s/game_%02d.pbin", opts.corpusDir, i);
+            if (!writeInputLog(&logs[i], filename))
+            {
+                return 1;
+            }
+        }
+        printf("Wrote %d games to %s\n", numLogs, opts.corpusDir);
+        return 0;
+    }
+
+    ThroughputResults results = {};
+    results.numRuns = opts.numRuns;
+    for (int i = 0; i < numLogs; ++i)
+    {
+        results.numFrames += logs[i].numFrames;
+    }
+
+    RenderData* rd = opts.isRendering ? (RenderData*)malloc(sizeof(RenderData)) : nullptr;
+    double ticksPerSecond[throughputRunsCap];
+    RunTimes total = {};
+
+    // Everything is allocated by now but the render data, which is set up outside the frames
+    setAllocCheckMode(allocCheckLog);
+
+    // One untimed run to warm up the caches
+    RunTimes first = replayLogs(logs, numLogs, &table, opts.isRendering, rd);
+    results.numTicks = first.numTicks;
+    results.stateHash = first.stateHash;
+
+    for (int run = 0; run < opts.numRuns; ++run)
+    {
+        RunTimes times = replayLogs(logs, numLogs, &table, opts.isRendering, rd);
+        if (times.stateHash != results.stateHash)
+        {
+            fprintf(stderr, "Run %d played out differently, the simulation isn't deterministic\n", run);
+            return 1;
+        }
+        ticksPerSecond[run] = times.numTicks / times.simTime;
+        total.simTime += times.simTime;
+        total.fillTime += times.fillTime;
+        total.layoutTime += times.layoutTime;
+        printf("Run %d: %u ticks in %.3f s, %.0f ticks/s\n", run, times.numTicks, times.simTime, ticksPerSecond[run]);
+    }
+
+    double sum = 0.0;
+    results.ticksPerSecondMin = ticksPerSecond[0];
+    results.ticksPerSecondMax = ticksPerSecond[0];
+    for (int run = 0; run < opts.numRuns; ++run)
+    {
+        sum += ticksPerSecond[run];
+        results.ticksPerSecondMin = fmin(results.ticksPerSecondMin, ticksPerSecond[run]);
+        results.ticksPerSecondMax = fmax(results.ticksPerSecondMax, ticksPerSecond[run]);
+    }
+    results.ticksPerSecond = sum / opts.numRuns;
+    double variance = 0.0;
+    for (int run = 0; run < opts.numRuns; ++run)
+    {
+        double d = ticksPerSecond[run] - results.ticksPerSecond;
+        variance += d * d;
+    }
+    results.ticksPerSecondStddev = sqrt(variance / opts.numRuns);
+
+    double numTicks = (double)results.numTicks * opts.numRuns;
+    double numFrames = (double)results.numFrames * opts.numRuns;
+    results.simNsPerTick = total.simTime * 1e9 / numTicks;
+    results.fillNsPerFrame = total.fillTime * 1e9 / numFrames;
+    results.layoutNsPerFrame = total.layoutTime * 1e9 / numFrames;
+
+    printf("%d games, %d frames, %u ticks: %.0f ticks/s (stddev %.0f, %.1f%%), %.0f ns per tick\n",
+        numLogs, results.numFrames, results.numTicks, results.ticksPerSecond, results.ticksPerSecondStddev,
+        results.ticksPerSecondStddev / results.ticksPerSecond * 100.0, results.simNsPerTick);
+    if (opts.isRendering)
+    {
+        printf("Per frame: %.0f ns filling render data, %.0f ns laying out text\n",
+            results.fillNsPerFrame, results.layoutNsPerFrame);
+    }
+
+    if (isAllocTracking)
+    {
+        results.frameAllocs = getAllocCheckFailures();
+        printf("Allocations in the frames: %llu (%llu bytes)%s\n",
+            (unsigned long long)results.frameAllocs.numAllocs, (unsigned long long)results.frameAllocs.numBytes,
+            isAllocTrackingComplete ? "" : ", only operator new is counted on this platform");
+    }
+
+    if (opts.jsonFilename && !writeJson(opts.jsonFilename, &results))
+    {
+        return 1;
+    }
+
+    bool isPassing = !opts.baselineFilename || compareWithBaseline(&results, opts.baselineFilename, opts.threshold);
+
+    for (int i = 0; i < numLogs; ++i)
+    {
+        freeInputLog(&logs[i]);
+    }
+    free(logs);
+    free(rd);
+    freeTable(&table);
+
+    // A frame loop that allocates is a regression too
+    return (isPassing && results.frameAllocs.numAllocs == 0) ? 0 : 1;
+}
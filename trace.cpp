@@ -0,0 +1,169 @@
+#include "trace.h"
+
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+std::atomic<bool> isTracing{ false };
+
+struct TraceBuffer
+{
+    // Ring of the last traceEventsCap events
+    TraceEvent* events;
+    // Ever added, only the thread that owns the buffer writes it
+    uint64_t numEvents;
+    int threadId;
+    char threadName[32];
+};
+
+static std::mutex traceMutex;
+static TraceBuffer* traceBuffers[traceThreadsCap];
+static int numTraceBuffers;
+static uint64_t traceStartNs;
+
+static thread_local TraceBuffer* threadTraceBuffer;
+
+static uint64_t getTraceNs()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Null when there are too many threads
+static TraceBuffer* getThreadTraceBuffer()
+{
+    if (!threadTraceBuffer)
+    {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        if (numTraceBuffers == traceThreadsCap)
+        {
+            return nullptr;
+        }
+        TraceBuffer* buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+        buffer->events = (TraceEvent*)malloc(traceEventsCap * sizeof(TraceEvent));
+        buffer->threadId = numTraceBuffers;
+        traceBuffers[numTraceBuffers++] = buffer;
+        threadTraceBuffer = buffer;
+    }
+    return threadTraceBuffer;
+}
+
+void initTracing()
+{
+    traceStartNs = getTraceNs();
+    isTracing.store(true);
+}
+
+void freeTracing()
+{
+    isTracing.store(false);
+    std::lock_guard<std::mutex> lock(traceMutex);
+    for (int i = 0; i < numTraceBuffers; ++i)
+    {
+        free(traceBuffers[i]->events);
+        free(traceBuffers[i]);
+    }
+    numTraceBuffers = 0;
+}
+
+void setTraceThreadName(const char* name)
+{
+    if (!isTracing.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    TraceBuffer* buffer = getThreadTraceBuffer();
+    if (buffer)
+    {
+        snprintf(buffer->threadName, sizeof buffer->threadName, "%s", name);
+    }
+}
+
+void addTraceEvent(const char* name)
+{
+    TraceBuffer* buffer = getThreadTraceBuffer();
+    if (!buffer)
+    {
+        return;
+    }
+    TraceEvent* event = &buffer->events[buffer->numEvents % traceEventsCap];
+    event->name = name;
+    event->ns = getTraceNs();
+    ++buffer->numEvents;
+}
+
+static void writeTraceEvent(FILE* file, bool* isFirst, const char* name, char phase, uint64_t ns, int threadId)
+{
+    fprintf(file, "%s\n", *isFirst ? "" : ",");
+    *isFirst = false;
+    // Microseconds
+    double ts = (double)(ns - traceStartNs) / 1000.0;
+    if (name)
+    {
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", name, phase, ts, threadId);
+    }
+    else
+    {
+        fprintf(file, "{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", phase, ts, threadId);
+    }
+}
+
+bool writeTrace(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    bool isFirst = true;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (int bufferIndex = 0; bufferIndex < numTraceBuffers; ++bufferIndex)
+    {
+        const TraceBuffer* buffer = traceBuffers[bufferIndex];
+        if (buffer->threadName[0])
+        {
+            fprintf(file, "%s\n", isFirst ? "" : ",");
+            isFirst = false;
+            fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                buffer->threadId, buffer->threadName);
+        }
+
+        // The ring may have lost the beginnings of the oldest events and the ends of the ones still going
+        uint64_t first = buffer->numEvents > traceEventsCap ? buffer->numEvents - traceEventsCap : 0;
+        int depth = 0;
+        uint64_t lastNs = traceStartNs;
+        for (uint64_t i = first; i < buffer->numEvents; ++i)
+        {
+            const TraceEvent* event = &buffer->events[i % traceEventsCap];
+            lastNs = event->ns;
+            if (event->name)
+            {
+                writeTraceEvent(file, &isFirst, event->name, 'B', event->ns, buffer->threadId);
+                ++depth;
+            }
+            else if (depth > 0)
+            {
+                writeTraceEvent(file, &isFirst, nullptr, 'E', event->ns, buffer->threadId);
+                --depth;
+            }
+        }
+        for (; depth > 0; --depth)
+        {
+            writeTraceEvent(file, &isFirst, nullptr, 'E', lastNs, buffer->threadId);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    bool isOk = ferror(file) == 0;
+    isOk = fclose(file) == 0 && isOk;
+    if (!isOk)
+    {
+        fprintf(stderr, "Failed to write %s\n", filename);
+    }
+    return isOk;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Timeline of what the threads were doing, written out as a Chrome trace to open in chrome://tracing or
+// ui.perfetto.dev. Every thread records begin and end events into a ring of its own, so recording takes
+// no lock and only the last traceEventsCap events of each thread are kept. Tracing is off until
+// initTracing(), until then a trace point costs a load and a branch.
+
+constexpr int traceEventsCap = 1 << 16;
+// Threads past this many aren't traced
+constexpr int traceThreadsCap = 64;
+
+struct TraceEvent
+{
+    // A string literal, null for the end of the innermost event
+    const char* name;
+    uint64_t ns;
+};
+
+extern std::atomic<bool> isTracing;
+
+void initTracing();
+// The threads that traced have to be finished or idle
+bool writeTrace(const char* filename);
+// At exit, no tracing after this
+void freeTracing();
+
+// Names the calling thread in the trace
+void setTraceThreadName(const char* name);
+
+void addTraceEvent(const char* name);
+
+inline void beginTraceEvent(const char* name)
+{
+    if (isTracing.load(std::memory_order_relaxed))
+    {
+        addTraceEvent(name);
+    }
+}
+
+inline void endTraceEvent()
+{
+    if (isTracing.load(std::memory_order_relaxed))
+    {
+        addTraceEvent(nullptr);
+    }
+}
+
+struct TraceScope
+{
+    explicit TraceScope(const char* name)
+    {
+        beginTraceEvent(name);
+    }
+
+    ~TraceScope()
+    {
+        endTraceEvent();
+    }
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+// Traces the rest of the enclosing scope
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)